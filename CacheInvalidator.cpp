@@ -0,0 +1,137 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "CacheInvalidator.hpp"
+
+#include "SubstitutionManager.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+// ============================================================================================== //
+// [CacheInvalidator]                                                                             //
+// ============================================================================================== //
+
+CacheInvalidator::CacheInvalidator(ResultCache& cache, RefreshFunction refresh)
+    : m_cache(cache)
+    , m_refresh(std::move(refresh))
+    , m_generation(0)
+    , m_evictions(0)
+    , m_untrackedResults(false)
+{
+
+}
+
+void CacheInvalidator::reset(const RuleSet& ruleSet)
+{
+    m_rules = ruleSet.rules();
+    m_generation = ruleSet.generation();
+    m_evictions = m_cache.evictions();
+}
+
+bool CacheInvalidator::rulesChanged(const RuleSet& ruleSet)
+{
+    // The cache can only be carried over from the generation right before.
+    if (ruleSet.generation() != m_generation + 1)
+    {
+        refresh(ruleSet);
+        return true;
+    }
+
+    std::unordered_map<const Substitution*, size_t> previous;
+    for (size_t i = 0; i < m_rules.size(); ++i)
+        previous.emplace(m_rules[i].get(), i);
+
+    // The remaining rules must come first, in their previous order, followed by the added.
+    const auto& rules = ruleSet.rules();
+    std::vector<unsigned> added;
+    size_t lastRemaining = 0;
+    for (unsigned i = 0; i < rules.size(); ++i)
+    {
+        auto it = previous.find(rules[i].get());
+        if (it == previous.end())
+        {
+            added.push_back(i);
+            continue;
+        }
+        if (!added.empty() || it->second < lastRemaining)
+        {
+            refresh(ruleSet);
+            return true;
+        }
+        lastRemaining = it->second;
+        previous.erase(it);
+    }
+
+    std::vector<const Substitution*> removed;
+    removed.reserve(previous.size());
+    for (auto it = previous.cbegin(), end = previous.cend(); it != end; ++it)
+        removed.push_back(it->first);
+
+    // Until an added rule rewrites a name, the others treat it the same as before. The added
+    // rules come last, so they are tried on what the others left at the end of each round, 
+    // i.e. the strings elisions started from and the result. 
+    std::vector<unsigned> candidates;
+    std::vector<uint32_t> literalHits;
+    auto mayMatch = [&](const std::string& text) -> bool
+    {
+        ruleSet.findCandidates(text.data(), text.data() + text.size(), candidates, 
+            literalHits);
+        return std::any_of(added.cbegin(), added.cend(), [&](unsigned rule)
+        {
+            return std::binary_search(candidates.cbegin(), candidates.cend(), rule);
+        });
+    };
+    auto mayChange = [&](const char* /*mangled*/, const std::string& text, 
+        const RewriteTrace& trace) -> bool
+    {
+        if (added.empty())
+            return false;
+        if (trace.stoppedEarly)
+            return true;
+        return mayMatch(text) 
+            || std::any_of(trace.elidedFrom.cbegin(), trace.elidedFrom.cend(), mayMatch);
+    };
+
+    const auto dropped = m_cache.carryOver(m_generation, ruleSet.generation(), removed, 
+        mayChange);
+    if (dropped || m_cache.evictions() != m_evictions || m_untrackedResults)
+    {
+        refresh(ruleSet);
+        return true;
+    }
+
+    reset(ruleSet);
+    return false;
+}
+
+void CacheInvalidator::refresh(const RuleSet& ruleSet)
+{
+    // Names answered from now on are tracked again, those from before are refreshed.
+    m_untrackedResults = false;
+    reset(ruleSet);
+    m_refresh();
+}
+
+// ============================================================================================== //
@@ -0,0 +1,98 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef CACHEINVALIDATOR_HPP
+#define CACHEINVALIDATOR_HPP
+
+#include "Utils.hpp"
+#include "RuleSet.hpp"
+#include "ResultCache.hpp"
+
+#include <atomic>
+#include <functional>
+
+// ============================================================================================== //
+// [CacheInvalidator]                                                                             //
+// ============================================================================================== //
+
+/**
+ * @brief   Carries the result cache over rule changes, refreshing the views only if needed.
+ *
+ * Rules are only ever appended or removed, so a change can be described by the rules removed
+ * and the rules added behind the remaining ones. Cached names a removed rule rewrote are 
+ * found through the cache's reverse index and dropped. An added rule only gets to see a name 
+ * once all other rules are done with it, that is the cached result and, if defaulted arguments
+ * were elided, the strings recorded before each elision. The prefilter of the new rule set 
+ * tells whether it may match any of them; if so, or if the rewrite budget ran out, the entry 
+ * is dropped. All other entries stay valid.
+ *
+ * Every name the views show passed through the cache, unless the cache evicted it or it was
+ * answered from another cache. If neither happened and no entry was dropped, nothing visible
+ * changed and the refresh is skipped.
+ */
+class CacheInvalidator : public Utils::NonCopyable
+{
+public:
+    /**
+     * @brief   Makes the views demangle their names again.
+     */
+    typedef std::function<void ()> RefreshFunction;
+protected:
+    ResultCache& m_cache;
+    RefreshFunction m_refresh;
+    // The rules of the generation the cache was last carried over to.
+    RuleSet::SubstitutionList m_rules;
+    unsigned m_generation;
+    size_t m_evictions;
+    std::atomic<bool> m_untrackedResults;
+public:
+    /**
+     * @brief   Constructor.
+     * @param   cache   The cache to maintain.
+     * @param   refresh Called to refresh the views, e.g. by @c request_refresh.
+     */
+    CacheInvalidator(ResultCache& cache, RefreshFunction refresh);
+public:
+    /**
+     * @brief   Starts tracking changes from a rule set, without touching the cache.
+     */
+    void reset(const RuleSet& ruleSet);
+    /**
+     * @brief   Carries the cache over to a new rule set and refreshes the views if any name
+     *          they may show changed.
+     * @return  @c true if the views were refreshed.
+     */
+    bool rulesChanged(const RuleSet& ruleSet);
+    /**
+     * @brief   Notes that a name was answered bypassing the result cache. May be called from 
+     *          any thread.
+     */
+    void untrackedResult() { m_untrackedResults = true; }
+protected:
+    void refresh(const RuleSet& ruleSet);
+};
+
+// ============================================================================================== //
+
+#endif // CACHEINVALIDATOR_HPP
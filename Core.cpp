@@ -33,16 +33,43 @@
 #include <QDir>
 #include <QApplication>
 #include <QMessageBox>
+#include <cstring>
 #include <idp.hpp>
 #include <diskio.hpp>
 #include <loader.hpp>
+#include <name.hpp>
 
 // =============================================================================================== //
 // [Core]                                                                                          //
 // =============================================================================================== //
 
+namespace
+{
+    const size_t kDefaultResultCacheMemoryLimit = 16 * 1024 * 1024;
+    const size_t kDefaultSharedCacheSize = 32 * 1024 * 1024;
+    // Longer names are demangled for the requested mask only.
+    const uint kFormBufferLength = 8192;
+
+    /**
+     * @brief   Returns the path of the archive mirroring the rules in the settings.
+     */
+    QString ruleArchivePath()
+    {
+        return QDir(QString::fromLocal8Bit(get_user_idadir())).filePath("retypedef_rules.rtr");
+    }
+}
+
 Core::Core()
-    : m_originalMangler(nullptr)
+    : m_rulePersister(&m_substitutionManager, ruleArchivePath())
+    , m_resultCache(kDefaultResultCacheMemoryLimit)
+    , m_cacheInvalidator(m_resultCache, [] { request_refresh(IWID_NAMES | IWID_DISASMS); })
+    , m_originalMangler(nullptr)
+    , m_deriveDemangleVariants(false)
+    , m_prewarmOnLoad(false)
+    , m_persistResults(false)
+    , m_shareResults(false)
+    , m_sharedCacheSize(kDefaultSharedCacheSize)
+    , m_activeHookCalls(0)
 {
 #if IDA_SDK_VERSION >= 670
     action_desc_t action = 
@@ -56,34 +83,108 @@ Core::Core()
 
     register_action(action);
     attach_action_to_menu("Options/", "retypedef_open_name_subst_editor", 0);
+
+    action_desc_t cancelAction = 
+    {
+        sizeof(cancelAction),
+        "retypedef_cancel_prewarming",
+        "Cancel name pre-warming",
+        &m_cancelPrewarmingAction,
+        &PLUGIN
+    };
+
+    register_action(cancelAction);
+    attach_action_to_menu("Options/", "retypedef_cancel_prewarming", 0);
 #else
     add_menu_item("Options/", "Edit name substitutions...", nullptr, 0, 
         &Core::onOptionsMenuItemClicked, this);
+    add_menu_item("Options/", "Cancel name pre-warming", nullptr, 0, 
+        &Core::onCancelPrewarmingClicked, this);
 #endif
 
     // First start? Initialize with default rules.
     Settings settings;
+    m_resultCache.setMemoryLimit(settings.value(Settings::kResultCacheMemoryLimit, 
+        static_cast<qulonglong>(kDefaultResultCacheMemoryLimit)).toULongLong());
+
+    // Select the regex backend before any rule gets compiled.
+    auto backend = RegexBackend::fromName(settings.value(Settings::kRegexBackend, 
+        RegexBackend::name(RegexBackend::kStdRegex)).toString().toStdString());
+    if (!RegexBackend::isAvailable(backend))
+    {
+        msg("[" PLUGIN_NAME "] Regex backend \"%s\" is not available, using \"%s\".\n",
+            RegexBackend::name(backend), RegexBackend::name(RegexBackend::kStdRegex));
+        backend = RegexBackend::kStdRegex;
+    }
+    m_substitutionManager.setBackend(backend);
+    m_substitutionManager.setRewriteBudget(
+        settings.value(Settings::kRewriteIterationBudget, 
+            SubstitutionManager::kDefaultIterationBudget).toUInt(),
+        settings.value(Settings::kRewriteTimeBudgetMs, 
+            SubstitutionManager::kDefaultTimeBudgetMs).toUInt());
+    m_substitutionManager.setElideDefaultArguments(
+        settings.value(Settings::kElideDefaultTemplateArgs, false).toBool());
+    m_deriveDemangleVariants = settings.value(Settings::kDeriveDemangleVariants, false).toBool();
+    m_prewarmOnLoad = settings.value(Settings::kPrewarmOnLoad, false).toBool();
+    m_persistResults = settings.value(Settings::kPersistentCache, false).toBool();
+    m_shareResults = settings.value(Settings::kSharedCache, false).toBool();
+    m_sharedCacheSize = settings.value(Settings::kSharedCacheSize, 
+        static_cast<qulonglong>(kDefaultSharedCacheSize)).toULongLong();
+    StatisticsSampler::setRate(settings.value(Settings::kStatisticsSampleRate, 
+        StatisticsSampler::kDefaultRate).toUInt());
+
     if (settings.value(Settings::kFirstStart, true).toBool())
     {
         QSettings defaultRules(":/Misc/default_rules.ini", QSettings::IniFormat);
         SettingsImporterExporter importer(&m_substitutionManager, &defaultRules);
         importer.importRules();
-        saveToSettings();
+        m_rulePersister.flush();
         settings.setValue(Settings::kFirstStart, false);
     }
 
-    // Load rules from settings and subscribe to changes in the manager
+    // Load rules from the archive if it mirrors the settings, saving their compilation, else
+    // from settings. Subscribe to changes in the manager afterwards.
+    bool loadedFromArchive = false;
+    const auto archiveHash = settings.value(Settings::kRuleArchiveHash, 0).toULongLong();
     try
     {
-        SettingsImporterExporter importer(&m_substitutionManager, &settings);
-        importer.importRules();
+        ArchiveImporterExporter archive(&m_substitutionManager, ruleArchivePath());
+        if (archiveHash && archive.contentHash() == archiveHash)
+        {
+            archive.importRules();
+            loadedFromArchive = true;
+        }
+    }
+    catch (const ArchiveImporterExporter::Error& /*e*/)
+    {
+        // Missing or damaged, the settings have the same rules.
+    }
+
+    try
+    {
+        if (!loadedFromArchive)
+        {
+            SettingsImporterExporter importer(&m_substitutionManager, &settings, 
+                settings.value(Settings::kLazyCompilation, false).toBool());
+            importer.importRules();
+        }
     }
     catch (const SettingsImporterExporter::Error& e)
     {
         msg("[" PLUGIN_NAME "] Cannot load settings: %s\n", e.what());
     }
-    connect(&m_substitutionManager, SIGNAL(entryAdded()), SLOT(saveToSettings()));
-    connect(&m_substitutionManager, SIGNAL(entryDeleted()), SLOT(saveToSettings()));
+    {
+        SubstitutionManager::Snapshot ruleSet(m_substitutionManager.ruleSet());
+        m_cacheInvalidator.reset(*ruleSet);
+    }
+    connect(&m_substitutionManager, SIGNAL(rulesChanged()), SLOT(onRulesChanged()));
+
+    // Share results with other instances using the same rules.
+    if (m_shareResults)
+    {
+        attachSharedCache();
+        connect(&m_substitutionManager, SIGNAL(rulesChanged()), SLOT(attachSharedCache()));
+    }
 
     // Place demangler detour
     HMODULE hIdaWll = GetModuleHandleA("IDA.WLL");
@@ -96,10 +197,19 @@ Core::Core()
 
     m_demanglerDetour.reset(new DemanglerDetour(demangle, &Core::demanglerHookCallback));
     m_demanglerDetour->attach(m_originalMangler);
+
+    hook_to_notification_point(HT_UI, &Core::onUiNotification, this);
+    hook_to_notification_point(HT_IDP, &Core::onIdpNotification, this);
 }
 
 Core::~Core()
 {
+    unhook_from_notification_point(HT_IDP, &Core::onIdpNotification, this);
+    unhook_from_notification_point(HT_UI, &Core::onUiNotification, this);
+
+    // Workers call the original demangler, stop them before the detour goes away.
+    m_prewarmer.reset();
+
     // Remove demangler detour
     try
     {
@@ -115,8 +225,11 @@ Core::~Core()
 #if IDA_SDK_VERSION >= 670
     detach_action_from_menu("Options/", "retypedef_open_name_subst_editor");
     unregister_action("retypedef_open_name_subst_editor");
+    detach_action_from_menu("Options/", "retypedef_cancel_prewarming");
+    unregister_action("retypedef_cancel_prewarming");
 #else
     del_menu_item("Options/Edit name substitutions...");
+    del_menu_item("Options/Cancel name pre-warming");
 #endif
 }
 
@@ -131,6 +244,18 @@ action_state_t Core::OptionsMenuItemClickedAction::update(action_update_ctx_t *
 {
     return AST_ENABLE_ALWAYS;
 }
+
+int Core::CancelPrewarmingAction::activate(action_activation_ctx_t * /*ctx*/)
+{
+    onCancelPrewarmingClicked(&Core::instance());
+    return 1;
+}
+
+action_state_t Core::CancelPrewarmingAction::update(action_update_ctx_t * /*ctx*/)
+{
+    const auto& prewarmer = Core::instance().m_prewarmer;
+    return prewarmer && prewarmer->running() ? AST_ENABLE : AST_DISABLE;
+}
 #endif
 
 void Core::runPlugin()
@@ -141,42 +266,230 @@ void Core::runPlugin()
 int32 Core::demanglerHookCallback(char* answer, uint answerLength, 
     const char* str, uint32 disableMask)
 {
+    // Pre-warming backs off while hook calls are in progress.
     auto &thiz = instance();
-    auto ret = thiz.m_originalMangler(answer, answerLength, str, disableMask);
+    ScopedTimer timer(&thiz.m_hookStats.calls);
+    ++thiz.m_activeHookCalls;
+    const auto ret = thiz.demangle(answer, answerLength, str, disableMask, &thiz.m_hookStats);
+    --thiz.m_activeHookCalls;
+    return ret;
+}
+
+int32 Core::demangle(char* answer, uint answerLength, const char* str, uint32 disableMask,
+    HookStats* stats)
+{
+    if (!answer || answerLength == 0 || !str)
+        return m_originalMangler(answer, answerLength, str, disableMask);
+
+    // Pin the rule set for the whole call; edits from the UI publish a new one meanwhile.
+    SubstitutionManager::Snapshot ruleSet(m_substitutionManager.ruleSet());
+    const auto generation = ruleSet->generation();
+
+    const auto tag = cacheTag(*ruleSet);
+
+    int32 ret;
+    if (m_persistentCache.lookup(str, disableMask, tag, answer, answerLength, ret)
+            || m_sharedCache.lookup(str, disableMask, tag, answer, answerLength, ret))
+    {
+        m_cacheInvalidator.untrackedResult();
+        return ret;
+    }
+    if (m_resultCache.lookup(str, disableMask, generation, answer, answerLength, ret))
+        return ret;
+
+    // Rules run on the text demangled for the requested mask either way.
+    if (!m_deriveDemangleVariants || answerLength > kFormBufferLength
+            || !demangleFromForm(answer, answerLength, str, disableMask, stats, ret))
+    {
+        ScopedTimer timer(stats ? &stats->demangler : nullptr);
+        ret = m_originalMangler(answer, answerLength, str, disableMask);
+    }
 
     //msg("str: %s; ret: 0x%08X\n", str, ret);
 
-    if (answer && answerLength != 0)
-        thiz.m_substitutionManager.applyToString(answer, answerLength);
+    // Recorded with the result, rule changes use it to tell which names they affect.
+    static thread_local RewriteTrace trace;
+    trace.clear();
+    if (ret >= 0)
+    {
+        ScopedTimer timer(stats ? &stats->substitution : nullptr);
+        const MangledName mangled = { str, static_cast<uint32_t>(disableMask) };
+        m_substitutionManager.applyToString(*ruleSet, answer, answerLength, &mangled, &trace);
+    }
 
+    m_resultCache.insert(str, disableMask, generation, ret, 
+        ret >= 0 ? answer : nullptr, answerLength, trace);
+    publishResult(str, disableMask, tag, ret, answer, answerLength);
     return ret;
 }
 
+uint64_t Core::cacheTag(const RuleSet& ruleSet) const
+{
+    const uint32_t options[] = 
+    {
+        static_cast<uint32_t>(m_substitutionManager.backend()), 
+        m_substitutionManager.elideDefaultArguments(),
+        m_substitutionManager.iterationBudget(),
+        m_substitutionManager.timeBudgetMs(),
+        m_deriveDemangleVariants
+    };
+    return Utils::fnv1a(options, sizeof(options), ruleSet.contentHash());
+}
+
+void Core::publishResult(const char* str, uint32 disableMask, uint64_t tag, int32 ret, 
+    const char* answer, uint answerLength)
+{
+    if (!m_persistResults && !m_shareResults)
+        return;
+    const char* text = ret >= 0 ? answer : nullptr;
+    if (text && ::strlen(text) + 1 >= answerLength)
+        return;
+
+    if (m_persistResults)
+        m_persistentCache.record(str, disableMask, tag, ret, text);
+    if (m_shareResults)
+        m_sharedCache.insert(str, disableMask, tag, ret, text);
+}
+
+bool Core::demangleFromForm(char* answer, uint answerLength, const char* str, 
+    uint32 disableMask, HookStats* stats, int32& ret)
+{
+    if (m_resultCache.lookupVariant(str, disableMask, answer, answerLength, ret))
+        return true;
+
+    // Demangle with all derivable parts, the variants only leave some of them out.
+    static thread_local char buffer[kFormBufferLength];
+    const auto baseMask = DemangledForm::baseMask(disableMask);
+    {
+        ScopedTimer timer(stats ? &stats->demangler : nullptr);
+        ret = m_originalMangler(buffer, kFormBufferLength, str, baseMask);
+    }
+    if (ret < 0)
+    {
+        m_resultCache.insertForm(str, baseMask, ret, nullptr);
+        return true;
+    }
+
+    // A truncated name would render truncated variants.
+    if (::strlen(buffer) + 1 >= kFormBufferLength)
+        return false;
+
+    const DemangledForm form(buffer);
+    m_resultCache.insertForm(str, baseMask, ret, &form);
+    return form.render(disableMask, answer, answerLength);
+}
+
+void Core::startPrewarming()
+{
+    // Enumerate on the UI thread, the name list may change once analysis continues.
+    std::vector<std::string> names;
+    const size_t count = get_nlist_size();
+    names.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const char* name = get_nlist_name(i);
+        if (name)
+            names.push_back(name);
+    }
+
+    // Warm the forms the names window and the listings ask for.
+    const uint32 shortMask = inf.short_demnames;
+    const uint32 longMask = inf.long_demnames;
+    m_prewarmer.reset(new Prewarmer([this, shortMask, longMask](const std::string& name)
+    {
+        static thread_local char answer[MAXSTR];
+        demangle(answer, sizeof(answer), name.c_str(), shortMask, nullptr);
+        demangle(answer, sizeof(answer), name.c_str(), longMask, nullptr);
+
+        // Leave room for the names actually viewed rather than evicting them.
+        return m_resultCache.memoryUsage() < m_resultCache.memoryLimit() / 10 * 9;
+    }, m_activeHookCalls));
+    m_prewarmer->start(std::move(names));
+}
+
+int Core::onUiNotification(void* userData, int code, va_list va)
+{
+    auto thiz = reinterpret_cast<Core*>(userData);
+    if (code == ui_database_inited)
+    {
+        if (thiz->m_persistResults)
+        {
+            SubstitutionManager::Snapshot ruleSet(thiz->m_substitutionManager.ruleSet());
+            thiz->m_persistentCache.open(QString::fromLocal8Bit(database_idb) + ".rtdcache", 
+                thiz->cacheTag(*ruleSet));
+        }
+
+        // A new database has no names worth warming before analysis.
+        const int isNewDatabase = va_arg(va, int);
+        if (thiz->m_prewarmOnLoad && !isNewDatabase)
+            thiz->startPrewarming();
+    }
+    return 0;
+}
+
+int Core::onIdpNotification(void* userData, int code, va_list /*va*/)
+{
+    auto thiz = reinterpret_cast<Core*>(userData);
+    if (code == processor_t::closebase)
+    {
+        thiz->m_prewarmer.reset();
+        if (thiz->m_persistentCache.isOpen())
+        {
+            try
+            {
+                SubstitutionManager::Snapshot ruleSet(thiz->m_substitutionManager.ruleSet());
+                thiz->m_persistentCache.save(thiz->cacheTag(*ruleSet));
+            }
+            catch (const PersistentCache::Error& e)
+            {
+                msg("[" PLUGIN_NAME "] Cannot save result cache: %s\n", e.what());
+            }
+            thiz->m_persistentCache.close();
+        }
+    }
+    return 0;
+}
+
+bool Core::onCancelPrewarmingClicked(void* userData)
+{
+    auto thiz = reinterpret_cast<Core*>(userData);
+    if (thiz->m_prewarmer)
+        thiz->m_prewarmer->cancel();
+    return 0;
+}
+
 bool Core::onOptionsMenuItemClicked(void* userData)
 {
     auto thiz = reinterpret_cast<Core*>(userData);
     SubstitutionModel model(&thiz->m_substitutionManager);
     SubstitutionEditor editor(qApp->activeWindow());
     editor.setModel(&model);
+    editor.setHookStats(&thiz->m_hookStats);
 
     editor.exec();
     return 0;
 }
 
-void Core::saveToSettings()
+void Core::attachSharedCache()
 {
     try
     {
-        Settings settings;
-        SettingsImporterExporter exporter(&m_substitutionManager, &settings);
-        exporter.exportRules();
-
-        request_refresh(IWID_NAMES | IWID_DISASMS);
+        SubstitutionManager::Snapshot ruleSet(m_substitutionManager.ruleSet());
+        m_sharedCache.attach(cacheTag(*ruleSet), m_sharedCacheSize);
     }
-    catch (const SettingsImporterExporter::Error &e)
+    catch (const SharedCache::Error& e)
     {
-        msg("[" PLUGIN_NAME "] Cannot save to settings: %s\n", e.what());
+        msg("[" PLUGIN_NAME "] Cannot attach shared result cache: %s\n", e.what());
     }
 }
 
+void Core::onRulesChanged()
+{
+    m_rulePersister.schedule();
+
+    // Most edits only affect a few names, if any of those shown.
+    SubstitutionManager::Snapshot ruleSet(m_substitutionManager.ruleSet());
+    m_cacheInvalidator.rulesChanged(*ruleSet);
+}
+
 // ============================================================================================== //
@@ -28,11 +28,19 @@
 #include "Utils.hpp"
 #include "InlineDetour.hpp"
 #include "SubstitutionManager.hpp"
+#include "ResultCache.hpp"
+#include "Prewarmer.hpp"
+#include "PersistentCache.hpp"
+#include "SharedCache.hpp"
+#include "RulePersister.hpp"
+#include "CacheInvalidator.hpp"
+#include "Statistics.hpp"
 
 #include <QObject>
 #include <ida.hpp>
 #include <demangle.hpp>
 #include <memory>
+#include <atomic>
 #include <kernwin.hpp>
 
 // ============================================================================================== //
@@ -47,9 +55,22 @@ class Core : public QObject, public Utils::Singleton<Core>
     Q_OBJECT
 
     SubstitutionManager m_substitutionManager;
+    RulePersister m_rulePersister;
+    ResultCache m_resultCache;
+    CacheInvalidator m_cacheInvalidator;
     typedef InlineDetour<demangler_t> DemanglerDetour;
     std::unique_ptr<DemanglerDetour> m_demanglerDetour;
     demangler_t *m_originalMangler;
+    bool m_deriveDemangleVariants;
+    bool m_prewarmOnLoad;
+    PersistentCache m_persistentCache;
+    bool m_persistResults;
+    SharedCache m_sharedCache;
+    bool m_shareResults;
+    size_t m_sharedCacheSize;
+    std::atomic<unsigned> m_activeHookCalls;
+    HookStats m_hookStats;
+    std::unique_ptr<Prewarmer> m_prewarmer;
 public:
     /**
      * @brief   Default constructor.
@@ -74,12 +95,61 @@ public:
     static int32 idaapi demanglerHookCallback(char* answer, uint answerLength, 
         const char* str, uint32 disableMask);
 private:
+    /**
+     * @brief   Demangles and substitutes a name, serving it from the result cache if possible.
+     *          Same semantics as IDA's @c demangle routine.
+     * @param   stats   Receives the time spent demangling and substituting, if not @c nullptr.
+     */
+    int32 demangle(char* answer, uint answerLength, const char* str, uint32 disableMask,
+        HookStats* stats);
+    /**
+     * @brief   Identifies the results of a rule set in the persistent and the shared cache,
+     *          along with the settings affecting them.
+     */
+    uint64_t cacheTag(const RuleSet& ruleSet) const;
+    /**
+     * @brief   Records a freshly substituted result for the persistent cache and stores it in
+     *          the shared cache, unless it was truncated.
+     */
+    void publishResult(const char* str, uint32 disableMask, uint64_t tag, int32 ret, 
+        const char* answer, uint answerLength);
+    /**
+     * @brief   Calls the original demangler by rendering the result from a DemangledForm,
+     *          demangling the name with the base mask and caching the form first if necessary.
+     *          The result is not substituted yet.
+     * @return  @c false if the call cannot be served that way, the answer is undefined then.
+     */
+    bool demangleFromForm(char* answer, uint answerLength, const char* str, 
+        uint32 disableMask, HookStats* stats, int32& ret);
+    /**
+     * @brief   Starts filling the result cache with all names of the database in the 
+     *          background.
+     */
+    void startPrewarming();
+    /**
+     * @brief   Opens the persistent cache and starts pre-warming once a database is loaded.
+     * @param   userData    @c this.
+     * @return  Always 0.
+     */
+    static int idaapi onUiNotification(void* userData, int code, va_list va);
+    /**
+     * @brief   Cancels pre-warming and saves the persistent cache when the database is 
+     *          closed.
+     * @param   userData    @c this.
+     * @return  Always 0.
+     */
+    static int idaapi onIdpNotification(void* userData, int code, va_list va);
 #if IDA_SDK_VERSION >= 670
     struct OptionsMenuItemClickedAction : public action_handler_t
     {
         int idaapi activate(action_activation_ctx_t *ctx);
         action_state_t idaapi update(action_update_ctx_t *ctx);
     } m_optionsMenuItemClickedAction;
+    struct CancelPrewarmingAction : public action_handler_t
+    {
+        int idaapi activate(action_activation_ctx_t *ctx);
+        action_state_t idaapi update(action_update_ctx_t *ctx);
+    } m_cancelPrewarmingAction;
 #endif
     /**
      * @brief   Handles clicks on the "Edit name substitutions" menu entry in IDA.
@@ -87,11 +157,21 @@ private:
      * @return  Always 0.
      */
     static bool idaapi onOptionsMenuItemClicked(void* userData);
+    /**
+     * @brief   Handles clicks on the "Cancel name pre-warming" menu entry in IDA.
+     * @param   userData    @c this.
+     * @return  Always 0.
+     */
+    static bool idaapi onCancelPrewarmingClicked(void* userData);
 private slots:
     /**
-     * @brief   Saves the rules from the substitution manager to the settings.
+     * @brief   Schedules saving the rules and refreshes the names shown.
+     */
+    void onRulesChanged();
+    /**
+     * @brief   Attaches the shared cache to the segment of the current rules.
      */
-    void saveToSettings();
+    void attachSharedCache();
 };
 
 // ============================================================================================== //
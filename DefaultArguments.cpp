@@ -0,0 +1,368 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "DefaultArguments.hpp"
+
+#include "ScratchArena.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+
+// ============================================================================================== //
+// [Table]                                                                                        //
+// ============================================================================================== //
+
+const unsigned kMaxArguments = 5;
+
+/**
+ * @brief   Table row, defaults are alternatives separated by '|', @c nullptr where required.
+ */
+struct Entry
+{
+    const char* scope;
+    const char* name;
+    const char* defaults[kMaxArguments];
+};
+
+#define RETYPEDEF_PAIR_ALLOCATOR \
+    "std::allocator<std::pair<$0 const, $1>> | std::allocator<std::pair<const $0, $1>>"
+
+const Entry kTable[] =
+{
+    { "std",    "vector",               { nullptr, "std::allocator<$0>" } },
+    { "std",    "deque",                { nullptr, "std::allocator<$0>" } },
+    { "std",    "list",                 { nullptr, "std::allocator<$0>" } },
+    { "std",    "forward_list",         { nullptr, "std::allocator<$0>" } },
+    { "std",    "set",                  { nullptr, "std::less<$0>", "std::allocator<$0>" } },
+    { "std",    "multiset",             { nullptr, "std::less<$0>", "std::allocator<$0>" } },
+    { "std",    "map",                  { nullptr, nullptr, "std::less<$0>", 
+                                          RETYPEDEF_PAIR_ALLOCATOR } },
+    { "std",    "multimap",             { nullptr, nullptr, "std::less<$0>", 
+                                          RETYPEDEF_PAIR_ALLOCATOR } },
+    { "std",    "unordered_set",        { nullptr, "std::hash<$0>", "std::equal_to<$0>", 
+                                          "std::allocator<$0>" } },
+    { "std",    "unordered_multiset",   { nullptr, "std::hash<$0>", "std::equal_to<$0>", 
+                                          "std::allocator<$0>" } },
+    { "std",    "unordered_map",        { nullptr, nullptr, "std::hash<$0>", 
+                                          "std::equal_to<$0>", RETYPEDEF_PAIR_ALLOCATOR } },
+    { "std",    "unordered_multimap",   { nullptr, nullptr, "std::hash<$0>", 
+                                          "std::equal_to<$0>", RETYPEDEF_PAIR_ALLOCATOR } },
+    { "stdext", "hash_set",             { nullptr, "stdext::hash_compare<$0, std::less<$0>>", 
+                                          "std::allocator<$0>" } },
+    { "stdext", "hash_multiset",        { nullptr, "stdext::hash_compare<$0, std::less<$0>>", 
+                                          "std::allocator<$0>" } },
+    { "stdext", "hash_map",             { nullptr, nullptr, 
+                                          "stdext::hash_compare<$0, std::less<$0>>", 
+                                          RETYPEDEF_PAIR_ALLOCATOR } },
+    { "stdext", "hash_multimap",        { nullptr, nullptr, 
+                                          "stdext::hash_compare<$0, std::less<$0>>", 
+                                          RETYPEDEF_PAIR_ALLOCATOR } },
+    { "std",    "stack",                { nullptr, "std::deque<$0>" } },
+    { "std",    "queue",                { nullptr, "std::deque<$0>" } },
+    { "std",    "priority_queue",       { nullptr, "std::vector<$0>", "std::less<$0>" } },
+    { "std",    "basic_string",         { nullptr, "std::char_traits<$0>", 
+                                          "std::allocator<$0>" } },
+    { "std",    "basic_string_view",    { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_ios",            { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_streambuf",      { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_istream",        { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_ostream",        { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_iostream",       { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_filebuf",        { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_ifstream",       { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_ofstream",       { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_fstream",        { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_stringbuf",      { nullptr, "std::char_traits<$0>", 
+                                          "std::allocator<$0>" } },
+    { "std",    "basic_istringstream",  { nullptr, "std::char_traits<$0>", 
+                                          "std::allocator<$0>" } },
+    { "std",    "basic_ostringstream",  { nullptr, "std::char_traits<$0>", 
+                                          "std::allocator<$0>" } },
+    { "std",    "basic_stringstream",   { nullptr, "std::char_traits<$0>", 
+                                          "std::allocator<$0>" } },
+    { "std",    "istreambuf_iterator",  { nullptr, "std::char_traits<$0>" } },
+    { "std",    "ostreambuf_iterator",  { nullptr, "std::char_traits<$0>" } },
+    { "std",    "basic_regex",          { nullptr, "std::regex_traits<$0>" } },
+    { "std",    "match_results",        { nullptr, "std::allocator<std::sub_match<$0>>" } },
+    { "std",    "unique_ptr",           { nullptr, "std::default_delete<$0>" } },
+};
+
+#undef RETYPEDEF_PAIR_ALLOCATOR
+
+// ============================================================================================== //
+// [Helpers]                                                                                      //
+// ============================================================================================== //
+
+/**
+ * @brief   Per-thread buffers of the elision pass.
+ */
+struct Scratch
+{
+    TypeTree tree;
+    std::vector<bool> removed;
+    std::vector<uint32_t> argumentBegins;
+    std::vector<uint32_t> argumentEnds;
+    std::vector<std::pair<const char*, const char*>> cuts;
+};
+
+bool isInlineNamespace(const TypeTree::Token& token)
+{
+    static const char* const kNames[] = { "__1", "__cxx11" };
+
+    const size_t length = token.end - token.begin;
+    for (size_t i = 0; i < sizeof(kNames) / sizeof(*kNames); ++i)
+    {
+        if (::strlen(kNames[i]) == length && ::memcmp(kNames[i], token.begin, length) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool isText(const TypeTree::Token& token, const char* text)
+{
+    const size_t length = token.end - token.begin;
+    return ::strlen(text) == length && ::memcmp(text, token.begin, length) == 0;
+}
+
+/**
+ * @brief   Skips tokens that are insignificant for comparisons.
+ * @return  The next significant token before @p end, or @p end.
+ */
+uint32_t skip(const TypeTree& tree, const std::vector<bool>& removed, uint32_t idx, 
+    uint32_t end)
+{
+    while (idx < end)
+    {
+        const auto& token = tree[idx];
+        if (removed[idx] || token.elaborated)
+            ++idx;
+        else if (token.kind == TypeTree::kIdentifier && idx + 1 < end 
+                && tree[idx + 1].kind == TypeTree::kScope && isInlineNamespace(token))
+            idx += 2;
+        else
+            break;
+    }
+    return idx;
+}
+
+/**
+ * @brief   Checks whether an argument equals a default, the preceding arguments substituted.
+ * @param   argument    Index of the argument in @p scratch.
+ */
+bool matchesDefault(const Scratch& scratch, size_t argument, const TypeTree& def)
+{
+    const auto& subject = scratch.tree;
+    const auto& removed = scratch.removed;
+    const auto end = scratch.argumentEnds[argument];
+
+    auto cur = skip(subject, removed, scratch.argumentBegins[argument], end);
+    for (size_t i = 0; i < def.size(); ++i)
+    {
+        const auto& token = def[i];
+        if (token.elaborated)
+            continue;
+
+        if (token.kind != TypeTree::kVariable)
+        {
+            if (cur == end || !TypeTree::sameToken(token, subject[cur]))
+                return false;
+            cur = skip(subject, removed, cur + 1, end);
+            continue;
+        }
+
+        // Compare the referenced argument token by token.
+        const size_t ref = ::strtoul(token.begin + 1, nullptr, 10);
+        if (ref >= argument)
+            return false;
+        const auto refEnd = scratch.argumentEnds[ref];
+        for (auto pos = skip(subject, removed, scratch.argumentBegins[ref], refEnd); 
+            pos != refEnd; pos = skip(subject, removed, pos + 1, refEnd))
+        {
+            if (cur == end || !TypeTree::sameToken(subject[pos], subject[cur]))
+                return false;
+            cur = skip(subject, removed, cur + 1, end);
+        }
+    }
+    return cur == end;
+}
+
+// ============================================================================================== //
+
+}
+
+// ============================================================================================== //
+// [DefaultArgumentElider]                                                                        //
+// ============================================================================================== //
+
+DefaultArgumentElider::DefaultArgumentElider()
+{
+    const size_t count = sizeof(kTable) / sizeof(*kTable);
+    m_templates.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Template tmpl;
+        tmpl.name = kTable[i].name;
+        tmpl.scope = kTable[i].scope;
+        for (unsigned arg = 0; arg < kMaxArguments; ++arg)
+        {
+            tmpl.defaults.emplace_back();
+            for (auto alt = kTable[i].defaults[arg]; alt; )
+            {
+                auto altEnd = ::strchr(alt, '|');
+                tmpl.defaults.back().emplace_back();
+                tmpl.defaults.back().back().parse(alt, altEnd ? altEnd : alt + ::strlen(alt), 
+                    true);
+                alt = altEnd ? altEnd + 1 : nullptr;
+            }
+        }
+        while (!tmpl.defaults.empty() && tmpl.defaults.back().empty())
+            tmpl.defaults.pop_back();
+        m_templates.push_back(std::move(tmpl));
+    }
+
+    std::sort(m_templates.begin(), m_templates.end(), [](const Template& a, const Template& b)
+    {
+        return a.name < b.name;
+    });
+}
+
+const DefaultArgumentElider& DefaultArgumentElider::instance()
+{
+    static const DefaultArgumentElider elider;
+    return elider;
+}
+
+const DefaultArgumentElider::Template* DefaultArgumentElider::lookup(const TypeTree& subject, 
+    uint32_t open) const
+{
+    // Expect "scope::name<", optionally with an inline namespace after the scope.
+    if (open < 3 || subject[open - 1].kind != TypeTree::kIdentifier 
+            || subject[open - 2].kind != TypeTree::kScope)
+        return nullptr;
+    uint32_t scope = open - 3;
+    if (scope >= 2 && isInlineNamespace(subject[scope]) 
+            && subject[scope - 1].kind == TypeTree::kScope)
+        scope -= 2;
+    if (subject[scope].kind != TypeTree::kIdentifier 
+            || (scope >= 2 && subject[scope - 1].kind == TypeTree::kScope))
+        return nullptr;
+
+    const auto& name = subject[open - 1];
+    const std::string::size_type length = name.end - name.begin;
+    auto it = std::lower_bound(m_templates.cbegin(), m_templates.cend(), name, 
+        [length](const Template& tmpl, const TypeTree::Token& token)
+    {
+        return tmpl.name.compare(0, std::string::npos, token.begin, length) < 0;
+    });
+    for (; it != m_templates.cend() 
+        && it->name.compare(0, std::string::npos, name.begin, length) == 0; ++it)
+    {
+        if (isText(subject[scope], it->scope))
+            return &*it;
+    }
+    return nullptr;
+}
+
+bool DefaultArgumentElider::apply(char* str, size_t& length) const
+{
+    if (!::memchr(str, '<', length))
+        return false;
+
+    static thread_local Scratch scratch;
+    auto& subject = scratch.tree;
+    subject.parse(str, str + length, false);
+    scratch.removed.assign(subject.size(), false);
+    scratch.cuts.clear();
+
+    // Closing brackets come in the order innermost lists are completed.
+    for (uint32_t close = 0; close < subject.size(); ++close)
+    {
+        const auto open = subject[close].partner;
+        if (subject[close].kind != TypeTree::kCloseAngle || open == TypeTree::kNone)
+            continue;
+        const auto* tmpl = lookup(subject, open);
+        if (!tmpl)
+            continue;
+
+        scratch.argumentBegins.clear();
+        scratch.argumentEnds.clear();
+        for (uint32_t begin = open + 1; begin < close; )
+        {
+            const auto end = subject[begin].argumentEnd;
+            if (end == TypeTree::kNone || end <= begin || end > close)
+                break;
+            scratch.argumentBegins.push_back(begin);
+            scratch.argumentEnds.push_back(end);
+            begin = end + 1;
+        }
+
+        // Walk back over the trailing arguments matching a default, the first is required.
+        auto keep = scratch.argumentBegins.size();
+        while (keep > 1 && keep - 1 < tmpl->defaults.size())
+        {
+            const auto& alternatives = tmpl->defaults[keep - 1];
+            auto it = alternatives.cbegin();
+            while (it != alternatives.cend() && !matchesDefault(scratch, keep - 1, *it))
+                ++it;
+            if (it == alternatives.cend())
+                break;
+            --keep;
+        }
+        if (keep == scratch.argumentBegins.size())
+            continue;
+
+        // Cut from the comma before the first elided argument up to the closing bracket.
+        const auto comma = scratch.argumentBegins[keep] - 1;
+        std::fill(scratch.removed.begin() + comma, scratch.removed.begin() + close, true);
+        scratch.cuts.emplace_back(subject[comma].begin, subject[close].begin);
+    }
+
+    if (scratch.cuts.empty())
+        return false;
+
+    // Outer cuts may enclose earlier inner ones.
+    std::sort(scratch.cuts.begin(), scratch.cuts.end());
+    auto& processed = ScratchArena::local().text();
+    processed.clear();
+    const char* pos = str;
+    for (auto it = scratch.cuts.cbegin(), end = scratch.cuts.cend(); it != end; ++it)
+    {
+        if (it->first >= pos)
+            processed.append(pos, it->first - pos);
+        pos = std::max(pos, it->second);
+    }
+    processed.append(pos, str + length - pos);
+
+    length = processed.size();
+    ::memcpy(str, processed.data(), length);
+    str[length] = '\0';
+    return true;
+}
+
+// ============================================================================================== //
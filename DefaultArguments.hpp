@@ -0,0 +1,95 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DEFAULTARGUMENTS_HPP
+#define DEFAULTARGUMENTS_HPP
+
+#include "Utils.hpp"
+#include "TypeTree.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================================== //
+// [DefaultArgumentElider]                                                                        //
+// ============================================================================================== //
+
+/**
+ * @brief   Removes trailing template arguments that equal their defaults.
+ *
+ * Knows the standard containers, strings, streams and smart pointers as well as the MSVC
+ * hash containers. Defaults are written as types in terms of the preceding arguments, e.g.
+ * "std::allocator<$0>" for the second argument of std::vector. Argument lists are processed
+ * innermost first in a single pass over the name, so an argument still compares equal to
+ * its default if its own defaulted arguments are removed in the same pass:
+ *
+ *   std::map<int, std::vector<int, std::allocator<int>>, std::less<int>,
+ *       std::allocator<std::pair<int const, std::vector<int, std::allocator<int>>>>>
+ *   -> std::map<int, std::vector<int>>
+ *
+ * Comparisons ignore whitespace, elaborated type specifiers and the inline namespaces of
+ * libc++ and libstdc++ ("std::__1", "std::__cxx11").
+ */
+class DefaultArgumentElider : public Utils::NonCopyable
+{
+public:
+    struct Template
+    {
+        std::string name;
+        const char* scope;
+        /**
+         * @brief   Alternative spellings of the default of each argument, none for required ones.
+         */
+        std::vector<std::vector<TypeTree>> defaults;
+    };
+private:
+    std::vector<Template> m_templates;
+public:
+    /**
+     * @brief   Returns the elider with the built-in table.
+     */
+    static const DefaultArgumentElider& instance();
+public:
+    /**
+     * @brief   Elides defaulted arguments in place. The name never grows.
+     * @param   str     The name, null-terminated.
+     * @param   length  The length of the name, updated.
+     * @return  @c true if anything was removed.
+     */
+    bool apply(char* str, size_t& length) const;
+protected:
+    DefaultArgumentElider();
+    /**
+     * @brief   Finds the template an argument list belongs to.
+     * @param   subject The parsed name.
+     * @param   open    Index of the opening angle bracket.
+     * @return  The template, or @c nullptr if it isn't in the table.
+     */
+    const Template* lookup(const TypeTree& subject, uint32_t open) const;
+};
+
+// ============================================================================================== //
+
+#endif // DEFAULTARGUMENTS_HPP
@@ -0,0 +1,215 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "DemangledForm.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <ida.hpp>
+#include <demangle.hpp>
+
+namespace
+{
+
+// ============================================================================================== //
+// [Keywords]                                                                                     //
+// ============================================================================================== //
+
+struct Keyword
+{
+    const char* text;
+    uint32_t flag;
+};
+
+const Keyword kKeywords[] =
+{
+    { "__cdecl",        MNG_NOCALLC },
+    { "__pascal",       MNG_NOCALLC },
+    { "__fortran",      MNG_NOCALLC },
+    { "__thiscall",     MNG_NOCALLC },
+    { "__stdcall",      MNG_NOCALLC },
+    { "__fastcall",     MNG_NOCALLC },
+    { "__clrcall",      MNG_NOCALLC },
+    { "__eabi",         MNG_NOCALLC },
+    { "__vectorcall",   MNG_NOCALLC },
+    { "__regcall",      MNG_NOCALLC },
+    { "public",         MNG_NOSCTYP },
+    { "protected",      MNG_NOSCTYP },
+    { "private",        MNG_NOSCTYP },
+    { "static",         MNG_NOSTVIR },
+    { "virtual",        MNG_NOSTVIR },
+    { "enum",           MNG_NOECSU },
+    { "class",          MNG_NOECSU },
+    { "struct",         MNG_NOECSU },
+    { "union",          MNG_NOECSU },
+};
+
+bool isIdentifierChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+uint32_t keywordFlag(const char* begin, const char* end)
+{
+    const size_t length = end - begin;
+    for (size_t i = 0; i < sizeof(kKeywords) / sizeof(*kKeywords); ++i)
+    {
+        if (::strlen(kKeywords[i].text) == length 
+                && ::memcmp(kKeywords[i].text, begin, length) == 0)
+            return kKeywords[i].flag;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Skips the symbol of an operator name, so its brackets aren't taken for nesting.
+ */
+const char* skipOperatorSymbol(const char* cur, const char* end)
+{
+    if (end - cur >= 2 && ((cur[0] == '(' && cur[1] == ')') || (cur[0] == '[' && cur[1] == ']')))
+        return cur + 2;
+    while (cur != end && ::strchr("<>=!+-*/%^&|~,", *cur))
+        ++cur;
+    return cur;
+}
+
+// ============================================================================================== //
+
+}
+
+// ============================================================================================== //
+// [DemangledForm]                                                                                //
+// ============================================================================================== //
+
+DemangledForm::DemangledForm()
+{
+
+}
+
+DemangledForm::DemangledForm(const char* text)
+    : m_text(text)
+{
+    const char* const begin = m_text.c_str();
+    const char* const end = begin + m_text.size();
+    unsigned quoteDepth = 0;
+    unsigned depth = 0;
+    for (const char* cur = begin; cur != end;)
+    {
+        // Skip special names, "`vftable'", "`local static guard'" and the like.
+        if (*cur == '`' || (*cur == '\'' && quoteDepth))
+        {
+            quoteDepth += *cur == '`' ? 1 : -1;
+            ++cur;
+            continue;
+        }
+        if (quoteDepth)
+        {
+            ++cur;
+            continue;
+        }
+        if (!isIdentifierChar(*cur))
+        {
+            if (*cur == '(' || *cur == '<' || *cur == '[')
+                ++depth;
+            else if ((*cur == ')' || *cur == '>' || *cur == ']') && depth)
+                --depth;
+            ++cur;
+            continue;
+        }
+
+        const char* wordEnd = cur;
+        while (wordEnd != end && isIdentifierChar(*wordEnd))
+            ++wordEnd;
+        if (wordEnd - cur == 8 && ::memcmp(cur, "operator", 8) == 0)
+        {
+            cur = skipOperatorSymbol(wordEnd, end);
+            continue;
+        }
+
+        auto flag = keywordFlag(cur, wordEnd);
+        if (depth && flag != MNG_NOECSU)
+            flag = 0;
+
+        // Access specifiers end with a colon, the others are followed by what they modify.
+        const char* spanEnd = wordEnd;
+        bool isKeyword = flag != 0;
+        if (flag == MNG_NOSCTYP)
+            isKeyword = spanEnd != end && *spanEnd++ == ':' && (spanEnd == end || *spanEnd != ':');
+        else if (flag && flag != MNG_NOCALLC)
+            isKeyword = spanEnd != end && *spanEnd == ' ';
+
+        if (isKeyword)
+        {
+            const char* spanBegin = cur;
+            if (spanEnd != end && *spanEnd == ' ')
+                ++spanEnd;
+            else if (spanBegin != begin && spanBegin[-1] == ' ' 
+                    && (spanEnd == end || *spanEnd == ')' || *spanEnd == ','))
+                --spanBegin;
+
+            Span span = { static_cast<uint32_t>(spanBegin - begin), 
+                static_cast<uint32_t>(spanEnd - begin), flag };
+            m_spans.push_back(span);
+        }
+        cur = wordEnd;
+    }
+}
+
+uint32_t DemangledForm::derivableMask()
+{
+    return MNG_NOCALLC | MNG_NOSCTYP | MNG_NOSTVIR | MNG_NOECSU;
+}
+
+bool DemangledForm::render(uint32_t disableMask, char* answer, uint32_t answerLength) const
+{
+    if (answerLength == 0)
+        return false;
+
+    uint32_t pos = 0;
+    uint32_t length = 0;
+    auto append = [&](uint32_t from, uint32_t to) -> bool
+    {
+        if (length + (to - from) >= answerLength)
+            return false;
+        ::memcpy(answer + length, m_text.data() + from, to - from);
+        length += to - from;
+        return true;
+    };
+
+    for (auto it = m_spans.cbegin(), end = m_spans.cend(); it != end; ++it)
+    {
+        if (!(it->flag & disableMask) || it->begin < pos)
+            continue;
+        if (!append(pos, it->begin))
+            return false;
+        pos = it->end;
+    }
+    if (!append(pos, static_cast<uint32_t>(m_text.size())))
+        return false;
+
+    answer[length] = '\0';
+    return true;
+}
+
+// ============================================================================================== //
@@ -0,0 +1,100 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DEMANGLEDFORM_HPP
+#define DEMANGLEDFORM_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================================== //
+// [DemangledForm]                                                                                //
+// ============================================================================================== //
+
+/**
+ * @brief   A demangled name from which the variants for several disable masks are rendered.
+ *
+ * IDA asks for the same symbol with different disable masks, e.g. with and without calling
+ * convention. The parts controlled by the derivable flags (see derivableMask()) are plain
+ * keywords in the MSVC demangler's output, so they are located once in the name demangled 
+ * with all of them enabled and simply left out when rendering a variant:
+ *
+ *   MNG_NOCALLC    __cdecl, __stdcall, __thiscall, __fastcall, ...
+ *   MNG_NOSCTYP    public:, protected:, private:
+ *   MNG_NOSTVIR    static, virtual
+ *   MNG_NOECSU     enum, class, struct, union
+ *
+ * Except for the type keywords of MNG_NOECSU, only keywords at the top level belong to the
+ * symbol itself, those within parentheses or template arguments are part of types and kept.
+ * Keywords inside special names ("`local static guard'") are not touched either.
+ *
+ * The form holds the demangler's output as is. Rules run on the rendered variant, so they see
+ * the same text as for a name demangled with the variant's mask directly.
+ */
+class DemangledForm
+{
+    struct Span
+    {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t flag;
+    };
+
+    std::string m_text;
+    std::vector<Span> m_spans;
+public:
+    DemangledForm();
+    /**
+     * @brief   Constructor.
+     * @param   text    The name, demangled with baseMask().
+     */
+    explicit DemangledForm(const char* text);
+public:
+    /**
+     * @brief   Returns the disable flags whose effect can be rendered from the form.
+     */
+    static uint32_t derivableMask();
+    /**
+     * @brief   Returns the mask a form serving @c disableMask is demangled with.
+     */
+    static uint32_t baseMask(uint32_t disableMask) { return disableMask & ~derivableMask(); }
+    /**
+     * @brief   Renders the variant for a disable mask.
+     * @param   disableMask     The mask, its base mask must be the one the form was made with.
+     * @param   answer          The output buffer.
+     * @param   answerLength    Length of @c answer.
+     * @return  @c false if the variant doesn't fit into the buffer, @c answer is undefined.
+     */
+    bool render(uint32_t disableMask, char* answer, uint32_t answerLength) const;
+    const std::string& text() const { return m_text; }
+    /**
+     * @brief   Returns the approximate memory used by the form.
+     */
+    size_t cost() const { return m_text.size() + m_spans.size() * sizeof(Span); }
+};
+
+// ============================================================================================== //
+
+#endif // DEMANGLEDFORM_HPP
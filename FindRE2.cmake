@@ -0,0 +1,41 @@
+#
+# The MIT License (MIT)
+#
+# Copyright (c) 2014 athre0z
+# 
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+# 
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+# 
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+cmake_minimum_required(VERSION 2.8.12)
+
+find_path(RE2_INCLUDE_DIR "re2/re2.h"
+	HINTS ${RE2_INCLUDEDIR} ${RE2_ROOT} $ENV{RE2_ROOT}
+	PATH_SUFFIXES "include")
+find_library(RE2_LIBRARY 
+	NAMES "re2"
+	HINTS ${RE2_LIBDIR} ${RE2_ROOT} $ENV{RE2_ROOT}
+	PATH_SUFFIXES "lib")
+
+set(RE2_INCLUDE_DIRS ${RE2_INCLUDE_DIR})
+set(RE2_LIBRARIES ${RE2_LIBRARY})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(re2 DEFAULT_MSG
+	RE2_LIBRARY RE2_INCLUDE_DIR)
+
+mark_as_advanced(RE2_INCLUDE_DIR RE2_LIBRARY)
\ No newline at end of file
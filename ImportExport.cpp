@@ -29,6 +29,11 @@
 #include "Config.hpp"
 
 #include <cassert>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <unordered_set>
 #include <ida.hpp>
 #include <idp.hpp>
 
@@ -37,9 +42,10 @@
 // ============================================================================================== //
 
 SettingsImporterExporter::SettingsImporterExporter(
-        SubstitutionManager* manager, QSettings* settings)
+        SubstitutionManager* manager, QSettings* settings, bool lazyCompilation)
     : m_manager(manager)
     , m_settings(settings)
+    , m_lazyCompilation(lazyCompilation)
 {
     assert(manager);
     assert(settings);
@@ -49,6 +55,12 @@ void SettingsImporterExporter::importRules() const
 {
     assert(m_manager);
 
+    std::unordered_set<std::string> patterns;
+    const auto& rules = m_manager->rules();
+    for (auto it = rules.cbegin(), end = rules.cend(); it != end; ++it)
+        patterns.insert((*it)->regexpPattern);
+
+    SubstitutionManager::SubstitutionList substs;
     int size = m_settings->beginReadArray(Settings::kSubstitutionGroup);
     for (int i = 0; i < size; ++i)
     {
@@ -58,31 +70,33 @@ void SettingsImporterExporter::importRules() const
             = m_settings->value(Settings::kSubstitutionReplacement).toString().toStdString();
         sbst->regexpPattern 
             = m_settings->value(Settings::kSubstitutionPattern).toString().toStdString();
-
-        try
+        sbst->mode = Substitution::modeFromName(
+            m_settings->value(Settings::kSubstitutionMode).toString().toStdString());
+        const auto guards = m_settings->value(Settings::kSubstitutionGuards).toStringList();
+        for (auto it = guards.cbegin(), end = guards.cend(); it != end; ++it)
         {
-            sbst->regexp = std::regex(sbst->regexpPattern, std::regex_constants::optimize);
-        }
-        catch (const std::regex_error &e) 
-        {
-            msg("[" PLUGIN_NAME "] Cannot import entry, invalid regexp: %s\n", e.what());
-            continue;
+            if (!it->trimmed().isEmpty())
+                sbst->declaredGuards.push_back(it->trimmed().toStdString());
         }
-        
-        const auto& substs = m_manager->rules();
-        auto it = std::find_if(substs.cbegin(), substs.cend(), 
-            [&sbst](const std::shared_ptr<Substitution>& cur) -> bool
-        {
-            assert(cur);
-            return cur->regexpPattern == sbst->regexpPattern;
-        });
-
-        if (it != substs.cend())
-            continue;
 
-        m_manager->addRule(std::move(sbst));
+        if (patterns.insert(sbst->regexpPattern).second)
+            substs.push_back(std::move(sbst));
     }
     m_settings->endArray();
+
+    // Compile in parallel, then report in order.
+    const auto errors = m_manager->compileRules(substs, m_lazyCompilation);
+    SubstitutionManager::SubstitutionList compiled;
+    compiled.reserve(substs.size());
+    for (size_t i = 0; i < substs.size(); ++i)
+    {
+        if (errors[i].empty())
+            compiled.push_back(std::move(substs[i]));
+        else
+            msg("[" PLUGIN_NAME "] Cannot import entry, invalid pattern: %s\n", errors[i].c_str());
+    }
+
+    m_manager->addRules(compiled);
 }
 
 void SettingsImporterExporter::exportRules() const
@@ -99,9 +113,710 @@ void SettingsImporterExporter::exportRules() const
             QString::fromStdString((*it)->regexpPattern));
         m_settings->setValue(Settings::kSubstitutionReplacement,
             QString::fromStdString((*it)->replacement));
+        m_settings->setValue(Settings::kSubstitutionMode, 
+            QString(Substitution::modeName((*it)->mode)));
+
+        QStringList guards;
+        for (auto guard = (*it)->declaredGuards.cbegin(), guardEnd = (*it)->declaredGuards.cend(); 
+            guard != guardEnd; ++guard)
+            guards << QString::fromStdString(*guard);
+        if (guards.isEmpty())
+            m_settings->remove(Settings::kSubstitutionGuards);
+        else
+            m_settings->setValue(Settings::kSubstitutionGuards, guards);
     }
     m_settings->endArray();
 }
 
 // ============================================================================================== //
-// 
\ No newline at end of file
+// [ArchiveImporterExporter]                                                                      //
+// ============================================================================================== //
+
+namespace
+{
+    const char kArchiveMagic[8] = { 'R', 'E', 'T', 'D', 'R', 'U', 'L', 'E' };
+    const uint32_t kArchiveFormatVersion = 1;
+
+    struct ArchiveHeader
+    {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t engineVersion;
+        uint32_t backend;
+        uint32_t ruleCount;
+        uint64_t contentHash;
+        uint64_t checksum;
+    };
+
+    /**
+     * @brief   Appends integers and length prefixed strings.
+     */
+    class ArchiveWriter
+    {
+        std::vector<char> m_data;
+    public:
+        explicit ArchiveWriter(size_t offset) : m_data(offset) {}
+
+        void u32(uint32_t value)
+        {
+            m_data.insert(m_data.end(), reinterpret_cast<const char*>(&value), 
+                reinterpret_cast<const char*>(&value) + sizeof(value));
+        }
+
+        void string(const std::string& value)
+        {
+            u32(static_cast<uint32_t>(value.size()));
+            m_data.insert(m_data.end(), value.cbegin(), value.cend());
+        }
+
+        void strings(const std::vector<std::string>& values)
+        {
+            u32(static_cast<uint32_t>(values.size()));
+            for (auto it = values.cbegin(), end = values.cend(); it != end; ++it)
+                string(*it);
+        }
+
+        std::vector<char>& data() { return m_data; }
+    };
+
+    /**
+     * @brief   Reads what ArchiveWriter wrote, bounds checked.
+     */
+    class ArchiveReader
+    {
+        const uchar* m_cur;
+        const uchar* m_end;
+    public:
+        ArchiveReader(const uchar* begin, const uchar* end) : m_cur(begin), m_end(end) {}
+
+        uint32_t u32()
+        {
+            uint32_t value;
+            ::memcpy(&value, take(sizeof(value)), sizeof(value));
+            return value;
+        }
+
+        std::string string()
+        {
+            const auto length = u32();
+            return std::string(reinterpret_cast<const char*>(take(length)), length);
+        }
+
+        std::vector<std::string> strings()
+        {
+            // Every string takes at least its length, so a damaged count fails early.
+            const auto count = u32();
+            if (count > static_cast<size_t>(m_end - m_cur) / sizeof(uint32_t))
+                throw ArchiveImporterExporter::Error("damaged rule archive");
+
+            std::vector<std::string> values;
+            values.reserve(count);
+            for (uint32_t i = 0; i < count; ++i)
+                values.push_back(string());
+            return values;
+        }
+    private:
+        const uchar* take(size_t length)
+        {
+            if (length > static_cast<size_t>(m_end - m_cur))
+                throw ArchiveImporterExporter::Error("damaged rule archive");
+            auto data = m_cur;
+            m_cur += length;
+            return data;
+        }
+    };
+
+    /**
+     * @brief   Maps an archive and validates its header.
+     */
+    const ArchiveHeader& mapArchive(QFile& file, const uchar*& end)
+    {
+        if (!file.open(QIODevice::ReadOnly))
+            throw ArchiveImporterExporter::Error("cannot open rule archive");
+
+        const auto size = file.size();
+        auto data = size >= static_cast<qint64>(sizeof(ArchiveHeader)) 
+            ? file.map(0, size) : nullptr;
+        if (!data)
+            throw ArchiveImporterExporter::Error("cannot read rule archive");
+
+        auto& header = *reinterpret_cast<const ArchiveHeader*>(data);
+        if (::memcmp(header.magic, kArchiveMagic, sizeof(kArchiveMagic)) != 0)
+            throw ArchiveImporterExporter::Error("not a rule archive");
+        if (header.formatVersion != kArchiveFormatVersion)
+            throw ArchiveImporterExporter::Error("unsupported rule archive format");
+
+        end = data + size;
+        return header;
+    }
+}
+
+ArchiveImporterExporter::ArchiveImporterExporter(SubstitutionManager* manager, 
+        const QString& path)
+    : m_manager(manager)
+    , m_path(path)
+{
+    assert(manager);
+}
+
+uint64_t ArchiveImporterExporter::contentHash() const
+{
+    QFile file(m_path);
+    const uchar* end;
+    return mapArchive(file, end).contentHash;
+}
+
+void ArchiveImporterExporter::importRules() const
+{
+    assert(m_manager);
+
+    QFile file(m_path);
+    const uchar* end;
+    const auto& header = mapArchive(file, end);
+    auto body = reinterpret_cast<const uchar*>(&header + 1);
+    if (Utils::fnv1a(body, end - body) != header.checksum)
+        throw Error("damaged rule archive");
+
+    // The analysis is only valid for the engine and backend that produced it.
+    const auto backend = m_manager->backend();
+    const bool precompiled = header.engineVersion == PLUGIN_VERSION 
+        && header.backend == static_cast<uint32_t>(backend);
+
+    std::unordered_set<std::string> patterns;
+    const auto& rules = m_manager->rules();
+    for (auto it = rules.cbegin(), rulesEnd = rules.cend(); it != rulesEnd; ++it)
+        patterns.insert((*it)->regexpPattern);
+
+    // Parse everything before adding anything, so a damaged archive imports nothing.
+    ArchiveReader reader(body, end);
+    SubstitutionManager::SubstitutionList substs;
+    for (uint32_t i = 0; i < header.ruleCount; ++i)
+    {
+        auto sbst = std::make_shared<Substitution>();
+        const auto mode = reader.u32();
+        sbst->regexpPattern = reader.string();
+        sbst->replacement = reader.string();
+        sbst->declaredGuards = reader.strings();
+        const auto groupCount = reader.u32();
+        const auto groupNames = reader.strings();
+        const auto alternatives = reader.u32();
+        for (uint32_t j = 0; j < alternatives; ++j)
+            sbst->requiredLiterals.push_back(reader.strings());
+        sbst->mangledGuards = reader.strings();
+
+        if (mode > Substitution::kModeType)
+            throw Error("damaged rule archive");
+        sbst->mode = static_cast<Substitution::Mode>(mode);
+        if (!patterns.insert(sbst->regexpPattern).second)
+            continue;
+
+        if (precompiled && sbst->mode != Substitution::kModeType)
+        {
+            sbst->matcher = RegexBackend::compileLazily(backend, sbst->regexpPattern, 
+                groupCount, groupNames);
+        }
+        substs.push_back(std::move(sbst));
+    }
+
+    // Type patterns are cheap to compile, and everything is compiled from its source unless
+    // the archive is precompiled.
+    SubstitutionManager::SubstitutionList pending;
+    for (auto it = substs.cbegin(), end = substs.cend(); it != end; ++it)
+    {
+        if (!(*it)->matcher)
+            pending.push_back(*it);
+    }
+    const auto errors = m_manager->compileRules(pending);
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        if (!errors[i].empty())
+            msg("[" PLUGIN_NAME "] Cannot import entry, invalid pattern: %s\n", errors[i].c_str());
+    }
+    substs.erase(std::remove_if(substs.begin(), substs.end(), 
+        [](const std::shared_ptr<Substitution>& sbst) { return !sbst->matcher; }), substs.end());
+
+    m_manager->addRules(substs, precompiled);
+}
+
+void ArchiveImporterExporter::exportRules() const
+{
+    assert(m_manager);
+
+    writeArchive(m_path, m_manager->rules(), m_manager->backend(), 
+        SubstitutionManager::Snapshot(m_manager->ruleSet())->contentHash());
+}
+
+void ArchiveImporterExporter::writeArchive(const QString& path, 
+    const std::vector<std::shared_ptr<Substitution>>& rules, RegexBackend::Kind backend, 
+    uint64_t contentHash)
+{
+    ArchiveWriter writer(sizeof(ArchiveHeader));
+    for (auto it = rules.cbegin(), end = rules.cend(); it != end; ++it)
+    {
+        const auto& rule = **it;
+        writer.u32(rule.mode);
+        writer.string(rule.regexpPattern);
+        writer.string(rule.replacement);
+        writer.strings(rule.declaredGuards);
+        writer.u32(rule.matcher->groupCount());
+        writer.strings(rule.matcher->groupNames());
+        writer.u32(static_cast<uint32_t>(rule.requiredLiterals.size()));
+        for (auto alternatives = rule.requiredLiterals.cbegin(), 
+                alternativesEnd = rule.requiredLiterals.cend(); 
+                alternatives != alternativesEnd; ++alternatives)
+            writer.strings(*alternatives);
+        writer.strings(rule.mangledGuards);
+    }
+
+    auto& data = writer.data();
+    ArchiveHeader header;
+    ::memcpy(header.magic, kArchiveMagic, sizeof(kArchiveMagic));
+    header.formatVersion = kArchiveFormatVersion;
+    header.engineVersion = PLUGIN_VERSION;
+    header.backend = backend;
+    header.ruleCount = static_cast<uint32_t>(rules.size());
+    header.contentHash = contentHash;
+    header.checksum = Utils::fnv1a(data.data() + sizeof(header), data.size() - sizeof(header));
+    ::memcpy(data.data(), &header, sizeof(header));
+
+    if (!Utils::writeFileAtomically(path, data.data(), data.size()))
+        throw Error("cannot write rule archive");
+}
+
+// ============================================================================================== //
+
+// ============================================================================================== //
+// [JsonLinesImporterExporter]                                                                    //
+// ============================================================================================== //
+
+namespace
+{
+    const char kJsonPattern[] = "pattern";
+    const char kJsonReplacement[] = "replacement";
+    const char kJsonMode[] = "mode";
+    const char kJsonGuards[] = "guards";
+
+    // Rules compiled per batch while the next batch is parsed.
+    const size_t kJsonBatchSize = 256;
+    // Values of unknown keys nested deeper are rejected rather than overflowing the stack.
+    const unsigned kJsonMaxDepth = 64;
+
+    /**
+     * @brief   Parses a rule from a line of JSON, just enough of JSON for that.
+     */
+    class JsonLineParser
+    {
+        const char* m_cur;
+        const char* m_end;
+        const char* m_error;
+    public:
+        JsonLineParser(const char* begin, const char* end) 
+            : m_cur(begin), m_end(end), m_error(nullptr) {}
+
+        /**
+         * @return  @c nullptr on success, else a description of the problem.
+         */
+        const char* parse(Substitution& sbst)
+        {
+            bool hasPattern = false;
+            std::string key, value;
+            if (!expect('{'))
+                return fail("expected an object");
+            if (!peek('}'))
+            {
+                do
+                {
+                    if (!string(key) || !expect(':'))
+                        return fail("expected a key");
+                    if (key == kJsonPattern)
+                        hasPattern = string(sbst.regexpPattern);
+                    else if (key == kJsonReplacement)
+                        string(sbst.replacement);
+                    else if (key == kJsonMode)
+                    {
+                        if (string(value))
+                        {
+                            sbst.mode = Substitution::modeFromName(value);
+                            if (value != Substitution::modeName(sbst.mode))
+                                return fail("unknown mode");
+                        }
+                    }
+                    else if (key == kJsonGuards)
+                        strings(sbst.declaredGuards);
+                    else
+                        skipValue();
+                    if (m_error)
+                        return m_error;
+                } while (expect(','));
+            }
+            if (!expect('}'))
+                return fail("expected ',' or '}'");
+            skipSpace();
+            if (m_cur != m_end)
+                return fail("unexpected text after the object");
+            if (!hasPattern || sbst.regexpPattern.empty())
+                return fail("missing pattern");
+            return nullptr;
+        }
+    private:
+        const char* fail(const char* error)
+        {
+            if (!m_error)
+                m_error = error;
+            return m_error;
+        }
+
+        void skipSpace()
+        {
+            while (m_cur != m_end && (*m_cur == ' ' || *m_cur == '\t' || *m_cur == '\r'))
+                ++m_cur;
+        }
+
+        bool peek(char c)
+        {
+            skipSpace();
+            return m_cur != m_end && *m_cur == c;
+        }
+
+        bool expect(char c)
+        {
+            if (!peek(c))
+                return false;
+            ++m_cur;
+            return true;
+        }
+
+        bool hex4(uint32_t& value)
+        {
+            if (m_end - m_cur < 4)
+                return false;
+            value = 0;
+            for (int i = 0; i < 4; ++i, ++m_cur)
+            {
+                const char c = *m_cur;
+                value <<= 4;
+                if (c >= '0' && c <= '9')
+                    value |= c - '0';
+                else if (c >= 'a' && c <= 'f')
+                    value |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F')
+                    value |= c - 'A' + 10;
+                else
+                    return false;
+            }
+            return true;
+        }
+
+        static void appendUtf8(std::string& out, uint32_t cp)
+        {
+            if (cp < 0x80)
+                out += static_cast<char>(cp);
+            else if (cp < 0x800)
+            {
+                out += static_cast<char>(0xC0 | cp >> 6);
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | cp >> 12);
+                out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | cp >> 18);
+                out += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+                out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        bool escape(std::string& out)
+        {
+            if (m_cur == m_end)
+                return false;
+            switch (*m_cur++)
+            {
+                case '"':  out += '"';  return true;
+                case '\\': out += '\\'; return true;
+                case '/':  out += '/';  return true;
+                case 'b':  out += '\b'; return true;
+                case 'f':  out += '\f'; return true;
+                case 'n':  out += '\n'; return true;
+                case 'r':  out += '\r'; return true;
+                case 't':  out += '\t'; return true;
+                case 'u':  break;
+                default:   return false;
+            }
+
+            uint32_t cp;
+            if (!hex4(cp) || (cp >= 0xDC00 && cp < 0xE000))
+                return false;
+            if (cp >= 0xD800 && cp < 0xDC00)
+            {
+                uint32_t low;
+                if (m_end - m_cur < 2 || m_cur[0] != '\\' || m_cur[1] != 'u')
+                    return false;
+                m_cur += 2;
+                if (!hex4(low) || low < 0xDC00 || low >= 0xE000)
+                    return false;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            appendUtf8(out, cp);
+            return true;
+        }
+
+        bool string(std::string& out)
+        {
+            if (!expect('"'))
+                return !fail("expected a string");
+
+            out.clear();
+            for (;;)
+            {
+                // Copy the run up to the next quote or escape in one go.
+                auto run = m_cur;
+                while (m_cur != m_end && *m_cur != '"' && *m_cur != '\\' 
+                        && static_cast<unsigned char>(*m_cur) >= 0x20)
+                    ++m_cur;
+                out.append(run, m_cur);
+
+                if (m_cur == m_end)
+                    return !fail("unterminated string");
+                if (*m_cur == '"')
+                {
+                    ++m_cur;
+                    return true;
+                }
+                if (*m_cur != '\\')
+                    return !fail("control character in string");
+                ++m_cur;
+                if (!escape(out))
+                    return !fail("invalid escape sequence");
+            }
+        }
+
+        void strings(std::vector<std::string>& out)
+        {
+            out.clear();
+            if (!expect('['))
+            {
+                fail("expected an array of strings");
+                return;
+            }
+            if (expect(']'))
+                return;
+
+            std::string value;
+            do
+            {
+                if (!string(value))
+                    return;
+                if (!value.empty())
+                    out.push_back(value);
+            } while (expect(','));
+            if (!expect(']'))
+                fail("expected ',' or ']'");
+        }
+
+        void skipValue(unsigned depth = 0)
+        {
+            std::string ignored;
+            if (depth >= kJsonMaxDepth)
+                fail("value nested too deeply");
+            else if (peek('"'))
+                string(ignored);
+            else if (expect('['))
+            {
+                if (expect(']'))
+                    return;
+                do
+                    skipValue(depth + 1);
+                while (!m_error && expect(','));
+                if (!m_error && !expect(']'))
+                    fail("expected ',' or ']'");
+            }
+            else if (expect('{'))
+            {
+                if (expect('}'))
+                    return;
+                do
+                {
+                    if (!string(ignored) || !expect(':'))
+                    {
+                        fail("expected a key");
+                        return;
+                    }
+                    skipValue(depth + 1);
+                } while (!m_error && expect(','));
+                if (!m_error && !expect('}'))
+                    fail("expected ',' or '}'");
+            }
+            else
+            {
+                // Numbers and literals.
+                auto begin = m_cur;
+                while (m_cur != m_end && (::isalnum(static_cast<unsigned char>(*m_cur)) 
+                        || *m_cur == '-' || *m_cur == '+' || *m_cur == '.'))
+                    ++m_cur;
+                if (m_cur == begin)
+                    fail("expected a value");
+            }
+        }
+    };
+}
+
+JsonLinesImporterExporter::JsonLinesImporterExporter(SubstitutionManager* manager, 
+        const QString& path)
+    : m_manager(manager)
+    , m_path(path)
+{
+    assert(manager);
+}
+
+size_t JsonLinesImporterExporter::importRules() const
+{
+    assert(m_manager);
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly))
+        throw Error("cannot open rule file");
+    const auto size = file.size();
+    auto data = size > 0 ? reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+    if (size > 0 && !data)
+        throw Error("cannot read rule file");
+    const char* const end = data + size;
+
+    std::unordered_set<std::string> patterns;
+    const auto& rules = m_manager->rules();
+    for (auto it = rules.cbegin(), rulesEnd = rules.cend(); it != rulesEnd; ++it)
+        patterns.insert((*it)->regexpPattern);
+
+    // Problems are collected with their line number and reported in file order at the end,
+    // the compiler runs behind the parser.
+    std::vector<std::pair<size_t, std::string>> problems;
+    SubstitutionManager::SubstitutionList compiled;
+
+    SubstitutionManager::SubstitutionList batch, compiling;
+    std::vector<size_t> batchLines, compilingLines;
+    std::vector<std::string> errors;
+    std::thread compiler;
+    auto collect = [&]
+    {
+        if (compiler.joinable())
+            compiler.join();
+        for (size_t i = 0; i < compiling.size(); ++i)
+        {
+            if (errors[i].empty())
+                compiled.push_back(std::move(compiling[i]));
+            else
+                problems.emplace_back(compilingLines[i], "invalid pattern: " + errors[i]);
+        }
+        compiling.clear();
+        compilingLines.clear();
+    };
+    auto compileBatch = [&]
+    {
+        collect();
+        if (batch.empty())
+            return;
+        compiling.swap(batch);
+        compilingLines.swap(batchLines);
+        compiler = std::thread([&] { errors = m_manager->compileRules(compiling); });
+    };
+
+    size_t lineNumber = 0;
+    auto cur = data;
+    if (end - cur >= 3 && ::memcmp(cur, "\xEF\xBB\xBF", 3) == 0)
+        cur += 3;
+    while (cur < end)
+    {
+        auto lineEnd = static_cast<const char*>(::memchr(cur, '\n', end - cur));
+        if (!lineEnd)
+            lineEnd = end;
+        auto line = cur;
+        cur = lineEnd + 1;
+        ++lineNumber;
+
+        while (line != lineEnd && (*line == ' ' || *line == '\t' || *line == '\r'))
+            ++line;
+        if (line == lineEnd)
+            continue;
+
+        auto sbst = std::make_shared<Substitution>();
+        JsonLineParser parser(line, lineEnd);
+        if (auto error = parser.parse(*sbst))
+        {
+            problems.emplace_back(lineNumber, error);
+            continue;
+        }
+        if (!patterns.insert(sbst->regexpPattern).second)
+            continue;
+
+        batch.push_back(std::move(sbst));
+        batchLines.push_back(lineNumber);
+        if (batch.size() == kJsonBatchSize)
+            compileBatch();
+    }
+    compileBatch();
+    collect();
+
+    std::stable_sort(problems.begin(), problems.end(), 
+        [](const std::pair<size_t, std::string>& a, const std::pair<size_t, std::string>& b)
+    {
+        return a.first < b.first;
+    });
+    const auto fileName = m_path.toStdString();
+    for (auto it = problems.cbegin(), problemsEnd = problems.cend(); it != problemsEnd; ++it)
+    {
+        msg("[" PLUGIN_NAME "] Cannot import %s, line %u: %s\n", fileName.c_str(), 
+            static_cast<unsigned>(it->first), it->second.c_str());
+    }
+
+    m_manager->addRules(compiled);
+    return problems.size();
+}
+
+void JsonLinesImporterExporter::exportRules() const
+{
+    assert(m_manager);
+
+    std::string data;
+    auto appendKey = [&](const char* key)
+    {
+        data += data.empty() || data.back() == '\n' ? "{\"" : ", \"";
+        data += key;
+        data += "\": ";
+    };
+
+    const auto& rules = m_manager->rules();
+    for (auto it = rules.cbegin(), end = rules.cend(); it != end; ++it)
+    {
+        const auto& rule = **it;
+        appendKey(kJsonPattern);
+        Utils::appendJsonString(data, rule.regexpPattern);
+        appendKey(kJsonReplacement);
+        Utils::appendJsonString(data, rule.replacement);
+        appendKey(kJsonMode);
+        Utils::appendJsonString(data, Substitution::modeName(rule.mode));
+        if (!rule.declaredGuards.empty())
+        {
+            appendKey(kJsonGuards);
+            data += '[';
+            for (auto guard = rule.declaredGuards.cbegin(), 
+                    guardEnd = rule.declaredGuards.cend(); guard != guardEnd; ++guard)
+            {
+                if (guard != rule.declaredGuards.cbegin())
+                    data += ", ";
+                Utils::appendJsonString(data, *guard);
+            }
+            data += ']';
+        }
+        data += "}\n";
+    }
+
+    if (!Utils::writeFileAtomically(m_path, data.data(), data.size()))
+        throw Error("cannot write rule file");
+}
+
+// ============================================================================================== //
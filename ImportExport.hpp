@@ -26,11 +26,17 @@
 #define IMPORTEXPORT_HPP
 
 #include "Utils.hpp"
+#include "RegexBackend.hpp"
 
 #include <stdexcept>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include <QSettings>
+#include <QString>
 
 class SubstitutionManager;
+struct Substitution;
 
 // ============================================================================================== //
 // [SettingsImporterExporter]                                                                     //
@@ -40,16 +46,110 @@ class SettingsImporterExporter : public Utils::NonCopyable
 {
     QSettings* m_settings;
     SubstitutionManager* m_manager;
+    bool m_lazyCompilation;
 public:
     class Error : public std::runtime_error
         { public: explicit Error(const char *error) : runtime_error(error) {} };
 public:
-    explicit SettingsImporterExporter(SubstitutionManager* manager, QSettings* settings);
+    /**
+     * @param   lazyCompilation Whether to compile the patterns when first needed instead of
+     *                          on import, see SubstitutionManager::compileRules. Meant for
+     *                          settings holding rules that were validated before.
+     */
+    explicit SettingsImporterExporter(SubstitutionManager* manager, QSettings* settings,
+        bool lazyCompilation = false);
     virtual ~SettingsImporterExporter() {}
+    /**
+     * @brief   Adds the rules not present yet. Invalid patterns are reported in the order of
+     *          the settings and skipped.
+     */
     void importRules() const;
     void exportRules() const;
 };
 
+// ============================================================================================== //
+// [ArchiveImporterExporter]                                                                      //
+// ============================================================================================== //
+
+/**
+ * @brief   Reads and writes rules in a binary archive.
+ *
+ * Besides the rules' sources, an archive holds everything determined when a rule is added:
+ * the capture groups, the required literals and the mangled guards. An archive written by the
+ * same engine version for the current regex backend is imported without compiling a single
+ * pattern; the regular expressions are compiled lazily once a name first reaches them. Other
+ * archives are imported from their sources. The file is memory mapped and parsed in place.
+ */
+class ArchiveImporterExporter : public Utils::NonCopyable
+{
+    SubstitutionManager* m_manager;
+    QString m_path;
+public:
+    class Error : public std::runtime_error
+        { public: explicit Error(const char *error) : runtime_error(error) {} };
+public:
+    explicit ArchiveImporterExporter(SubstitutionManager* manager, const QString& path);
+    virtual ~ArchiveImporterExporter() {}
+    /**
+     * @brief   Returns the content hash of the archived rules, see RuleSet::contentHash.
+     * @throws  Error   If the file cannot be read or is no archive of a known format.
+     */
+    uint64_t contentHash() const;
+    /**
+     * @brief   Adds the archived rules not present yet.
+     * @throws  Error   If the file cannot be read or is damaged, nothing is imported then.
+     */
+    void importRules() const;
+    /**
+     * @throws  Error   If the file cannot be written.
+     */
+    void exportRules() const;
+    /**
+     * @brief   Writes rules to an archive, replacing the file atomically. Independent of any
+     *          manager, so it may be called from any thread.
+     * @param   contentHash The rules' RuleSet::contentHash.
+     * @throws  Error   If the file cannot be written.
+     */
+    static void writeArchive(const QString& path, const std::vector<std::shared_ptr<
+        Substitution>>& rules, RegexBackend::Kind backend, uint64_t contentHash);
+};
+
+// ============================================================================================== //
+// [JsonLinesImporterExporter]                                                                    //
+// ============================================================================================== //
+
+/**
+ * @brief   Reads and writes rules as JSON Lines, one object per line:
+ *          @code {"pattern": "...", "replacement": "...", "mode": "match", "guards": []} @endcode
+ *
+ * Only @c pattern is required, @c mode defaults to @c match. Unknown keys are ignored. Meant
+ * for large rule libraries: the file is memory mapped and parsed in place, and batches of
+ * parsed rules are compiled while the following lines are still being parsed. A line that
+ * cannot be parsed or compiled is reported to the output window with its number and skipped,
+ * the remaining lines are imported nevertheless.
+ */
+class JsonLinesImporterExporter : public Utils::NonCopyable
+{
+    SubstitutionManager* m_manager;
+    QString m_path;
+public:
+    class Error : public std::runtime_error
+        { public: explicit Error(const char *error) : runtime_error(error) {} };
+public:
+    explicit JsonLinesImporterExporter(SubstitutionManager* manager, const QString& path);
+    virtual ~JsonLinesImporterExporter() {}
+    /**
+     * @brief   Adds the rules not present yet.
+     * @return  The number of lines skipped for errors.
+     * @throws  Error   If the file cannot be read.
+     */
+    size_t importRules() const;
+    /**
+     * @throws  Error   If the file cannot be written.
+     */
+    void exportRules() const;
+};
+
 // ============================================================================================== //
 
 #endif // IMPORTEXPORT_HPP
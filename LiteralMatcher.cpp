@@ -0,0 +1,156 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "LiteralMatcher.hpp"
+
+#include <deque>
+
+// ============================================================================================== //
+// [LiteralMatcher]                                                                               //
+// ============================================================================================== //
+
+namespace
+{
+    const uint32_t kNoState = ~0U;
+}
+
+LiteralMatcher::LiteralMatcher()
+    : m_charClasses(256, 0)
+    , m_classCount(1)
+    , m_transitions(1, 0)
+    , m_outputOffsets(2, 0)
+    , m_startBytes(256, 0)
+    , m_singleStartByte(-1)
+{
+    
+}
+
+LiteralMatcher::LiteralMatcher(const std::vector<std::string>& literals)
+    : m_charClasses(256, 0)
+    , m_classCount(1)
+    , m_startBytes(256, 0)
+    , m_singleStartByte(-1)
+{
+    // Every byte used by any literal gets a class of its own, all others share class 0.
+    for (auto it = literals.cbegin(), end = literals.cend(); it != end; ++it)
+    {
+        for (auto c = it->cbegin(), cend = it->cend(); c != cend; ++c)
+        {
+            auto& cls = m_charClasses[static_cast<uint8_t>(*c)];
+            if (!cls)
+                cls = static_cast<uint8_t>(m_classCount++);
+        }
+    }
+
+    // Build the trie.
+    std::vector<std::vector<uint32_t>> ownOutputs(1);
+    m_transitions.assign(m_classCount, kNoState);
+    for (uint32_t id = 0; id < literals.size(); ++id)
+    {
+        if (literals[id].empty())
+            continue;
+
+        uint32_t state = 0;
+        for (auto c = literals[id].cbegin(), cend = literals[id].cend(); c != cend; ++c)
+        {
+            auto& next = m_transitions[state * m_classCount 
+                + m_charClasses[static_cast<uint8_t>(*c)]];
+            if (next == kNoState)
+            {
+                next = static_cast<uint32_t>(ownOutputs.size());
+                ownOutputs.emplace_back();
+                m_transitions.resize(m_transitions.size() + m_classCount, kNoState);
+            }
+            state = m_transitions[state * m_classCount 
+                + m_charClasses[static_cast<uint8_t>(*c)]];
+        }
+        ownOutputs[state].push_back(id);
+    }
+
+    // Resolve failure links breadth-first, turning the trie into a DFA.
+    const auto stateCount = ownOutputs.size();
+    std::vector<uint32_t> fail(stateCount, 0);
+    std::vector<uint32_t> order;
+    order.reserve(stateCount);
+    std::deque<uint32_t> queue;
+
+    for (unsigned cls = 0; cls < m_classCount; ++cls)
+    {
+        auto& next = m_transitions[cls];
+        if (next == kNoState)
+            next = 0;
+        else
+            queue.push_back(next);
+    }
+
+    while (!queue.empty())
+    {
+        auto state = queue.front();
+        queue.pop_front();
+        order.push_back(state);
+
+        for (unsigned cls = 0; cls < m_classCount; ++cls)
+        {
+            auto& next = m_transitions[state * m_classCount + cls];
+            auto fallback = m_transitions[fail[state] * m_classCount + cls];
+            if (next == kNoState)
+            {
+                next = fallback;
+            }
+            else
+            {
+                fail[next] = fallback;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    // Flatten outputs, inheriting those of the failure state (already final in BFS order).
+    std::vector<std::vector<uint32_t>> outputs(std::move(ownOutputs));
+    for (auto it = order.cbegin(), end = order.cend(); it != end; ++it)
+    {
+        const auto& inherited = outputs[fail[*it]];
+        outputs[*it].insert(outputs[*it].end(), inherited.cbegin(), inherited.cend());
+    }
+
+    m_outputOffsets.reserve(stateCount + 1);
+    for (auto it = outputs.cbegin(), end = outputs.cend(); it != end; ++it)
+    {
+        m_outputOffsets.push_back(static_cast<uint32_t>(m_outputs.size()));
+        m_outputs.insert(m_outputs.end(), it->cbegin(), it->cend());
+    }
+    m_outputOffsets.push_back(static_cast<uint32_t>(m_outputs.size()));
+
+    unsigned startByteCount = 0;
+    for (unsigned byte = 0; byte < 256; ++byte)
+    {
+        if (m_transitions[m_charClasses[byte]] != 0)
+        {
+            m_startBytes[byte] = 1;
+            m_singleStartByte = startByteCount++ ? -1 : static_cast<int>(byte);
+        }
+    }
+}
+
+// ============================================================================================== //
@@ -0,0 +1,132 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef LITERALMATCHER_HPP
+#define LITERALMATCHER_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// ============================================================================================== //
+// [LiteralMatcher]                                                                               //
+// ============================================================================================== //
+
+/**
+ * @brief   Aho-Corasick automaton locating any number of literals in a single pass.
+ *
+ * Transitions are fully resolved at build time, so scanning costs one table lookup per
+ * input byte regardless of the number of literals. Text that cannot start a literal is 
+ * skipped without consulting the automaton, using memchr if all literals start with the
+ * same byte; most names contain few or none of the literals.
+ */
+class LiteralMatcher
+{
+    std::vector<uint8_t> m_charClasses;
+    unsigned m_classCount;
+    std::vector<uint32_t> m_transitions;
+    std::vector<uint32_t> m_outputOffsets;
+    std::vector<uint32_t> m_outputs;
+    // Bytes leaving the start state, and the only one if there is exactly one.
+    std::vector<uint8_t> m_startBytes;
+    int m_singleStartByte;
+public:
+    /**
+     * @brief   Constructs an automaton that never reports a match.
+     */
+    LiteralMatcher();
+    /**
+     * @brief   Constructs the automaton.
+     * @param   literals    The literals to search for. A literal's ID is its index, empty
+     *                      literals are ignored.
+     */
+    explicit LiteralMatcher(const std::vector<std::string>& literals);
+public:
+    /**
+     * @brief   Scans a string, invoking @c onMatch with the ID of every literal occurrence.
+     */
+    template<typename CallbackT>
+    void scan(const char* begin, const char* end, CallbackT onMatch) const;
+    /**
+     * @brief   Determines whether any literal occurs in a string, stopping at the first one.
+     */
+    bool containsAny(const char* begin, const char* end) const;
+    bool empty() const { return m_outputs.empty(); }
+};
+
+// ============================================================================================== //
+// Implementation of inline methods [LiteralMatcher]                                              //
+// ============================================================================================== //
+
+template<typename CallbackT> inline
+void LiteralMatcher::scan(const char* begin, const char* end, CallbackT onMatch) const
+{
+    if (empty())
+        return;
+
+    uint32_t state = 0;
+    for (auto cur = begin; cur != end; ++cur)
+    {
+        if (state == 0)
+        {
+            if (m_singleStartByte >= 0)
+            {
+                cur = static_cast<const char*>(::memchr(cur, m_singleStartByte, end - cur));
+                if (!cur)
+                    return;
+            }
+            else
+            {
+                while (!m_startBytes[static_cast<uint8_t>(*cur)])
+                {
+                    if (++cur == end)
+                        return;
+                }
+            }
+        }
+
+        state = m_transitions[state * m_classCount 
+            + m_charClasses[static_cast<uint8_t>(*cur)]];
+        for (auto i = m_outputOffsets[state], e = m_outputOffsets[state + 1]; i != e; ++i)
+            onMatch(m_outputs[i]);
+    }
+}
+
+inline bool LiteralMatcher::containsAny(const char* begin, const char* end) const
+{
+    bool found = false;
+    uint32_t state = 0;
+    for (auto cur = begin; cur != end && !found; ++cur)
+    {
+        state = m_transitions[state * m_classCount 
+            + m_charClasses[static_cast<uint8_t>(*cur)]];
+        found = m_outputOffsets[state] != m_outputOffsets[state + 1];
+    }
+    return found;
+}
+
+// ============================================================================================== //
+
+#endif // LITERALMATCHER_HPP
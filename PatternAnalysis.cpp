@@ -0,0 +1,575 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PatternAnalysis.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace PatternAnalysis
+{
+
+// ============================================================================================== //
+// [Helpers]                                                                                      //
+// ============================================================================================== //
+
+namespace
+{
+
+/**
+ * @brief   Returns the position right after the group or character class starting at @c pos.
+ */
+size_t skipBracketed(const std::string& pattern, size_t pos)
+{
+    int depth = 0;
+    bool inClass = false;
+    for (; pos < pattern.size(); ++pos)
+    {
+        const char c = pattern[pos];
+        if (c == '\\')
+        {
+            ++pos;
+            continue;
+        }
+
+        if (inClass)
+        {
+            if (c == ']')
+            {
+                inClass = false;
+                if (depth == 0)
+                    return pos + 1;
+            }
+            continue;
+        }
+
+        if (c == '[')
+            inClass = true;
+        else if (c == '(')
+            ++depth;
+        else if (c == ')' && --depth == 0)
+            return pos + 1;
+    }
+    return pattern.size();
+}
+
+/**
+ * @brief   Determines whether @c c, preceded by a backslash, denotes itself.
+ */
+bool isIdentityEscape(char c)
+{
+    return !std::isalnum(static_cast<unsigned char>(c)) && c != '\0';
+}
+
+bool isIdentifierChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+/**
+ * @brief   Words occurring in demangled MSVC names that are not spelled out when mangled.
+ */
+const char* const kEncodedWords[] =
+{
+    // Keywords and builtin types.
+    "void", "bool", "char", "short", "int", "long", "float", "double", "signed", "unsigned",
+    "wchar_t", "char8_t", "char16_t", "char32_t", "__int8", "__int16", "__int32", "__int64", 
+    "__int128", "nullptr_t", "const", "volatile", "class", "struct", "union", "enum", 
+    "public", "private", "protected", "virtual", "static", "extern", "operator", "new", 
+    "delete", "throw", "noexcept", "__cdecl", "__stdcall", "__thiscall", "__fastcall", 
+    "__vectorcall", "__clrcall", "__pascal", "__fortran", "__swift_1", "__swift_2", 
+    "__ptr32", "__ptr64", "__w64", "__restrict", "__unaligned", "__sptr", "__uptr", 
+    "__based", "__far", "__near", "__huge", "__gc", "__pin", "__box", "cli", "array", 
+    "pin_ptr", "interior_ptr",
+    // Special names.
+    "anonymous", "namespace", "vftable", "vbtable", "vcall", "typeof", "local", "guard", 
+    "thread", "string", "vector", "vbase", "scalar", "deleting", "destructor", 
+    "constructor", "iterator", "closure", "copy", "default", "placement", "managed", "eh", 
+    "omni", "callsig", "udt", "returning", "dynamic", "initializer", "atexit", "for", "at",
+    "RTTI", "Type", "Descriptor", "Base", "Class", "Array", "Hierarchy", "Complete", 
+    "Object", "Locator", "vtordisp", "vtordispex", "adjustor", "template", "parameter", 
+    "generic", "type", "non", "unknown", "ecsu", "auto", "decltype"
+};
+
+/**
+ * @brief   Determines whether an identifier fragment of a literal is spelled out when mangled.
+ * @param   openLeft    The fragment starts the literal, so it may continue a longer word.
+ * @param   openRight   The fragment ends the literal.
+ */
+bool isSpelledOut(const std::string& fragment, bool openLeft, bool openRight)
+{
+    if (std::isdigit(static_cast<unsigned char>(fragment[0])))
+        return false;
+
+    for (size_t i = 0; i < sizeof(kEncodedWords) / sizeof(*kEncodedWords); ++i)
+    {
+        const std::string word = kEncodedWords[i];
+        for (auto pos = word.find(fragment); pos != std::string::npos; 
+            pos = word.find(fragment, pos + 1))
+        {
+            if ((openLeft || pos == 0) && (openRight || pos + fragment.size() == word.size()))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief   Returns the longest fragment of a literal usable as a guard, empty if none.
+ */
+std::string mangledGuard(const std::string& literal)
+{
+    std::string best;
+    for (size_t pos = 0; pos < literal.size();)
+    {
+        if (!isIdentifierChar(literal[pos]))
+        {
+            ++pos;
+            continue;
+        }
+
+        auto end = pos;
+        while (end < literal.size() && isIdentifierChar(literal[end]))
+            ++end;
+        const auto fragment = literal.substr(pos, end - pos);
+        if (fragment.size() > best.size() 
+                && isSpelledOut(fragment, pos == 0, end == literal.size()))
+            best = fragment;
+        pos = end;
+    }
+    return best;
+}
+
+size_t shortestLength(const Alternatives& alternatives)
+{
+    size_t shortest = std::string::npos;
+    for (auto it = alternatives.cbegin(), end = alternatives.cend(); it != end; ++it)
+        shortest = std::min(shortest, it->size());
+    return shortest;
+}
+
+/**
+ * @brief   Recursive descent over the pattern, computing required literals bottom-up.
+ */
+class Parser
+{
+    const std::string& m_pattern;
+    size_t m_pos;
+    // Set on constructs the analysis doesn't model, see parseGroupPrefix.
+    bool m_inconclusive;
+public:
+    explicit Parser(const std::string& pattern) 
+        : m_pattern(pattern), m_pos(0), m_inconclusive(false) {}
+
+    /**
+     * @brief   Whether the pattern holds constructs that invalidate the literals found.
+     */
+    bool inconclusive() const { return m_inconclusive; }
+
+    /**
+     * @brief   Parses branches separated by '|' up to a closing parenthesis or the end.
+     */
+    RequiredLiterals parseAlternation()
+    {
+        RequiredLiterals result = parseSequence();
+        if (m_pos >= m_pattern.size() || m_pattern[m_pos] != '|')
+            return result;
+
+        // One literal of each branch's most selective alternatives has to occur.
+        Alternatives merged;
+        bool everyBranch = !result.empty();
+        if (everyBranch)
+            merged = result[mostSelective(result)];
+        while (m_pos < m_pattern.size() && m_pattern[m_pos] == '|')
+        {
+            ++m_pos;
+            const auto branch = parseSequence();
+            if (branch.empty())
+                everyBranch = false;
+            if (!everyBranch)
+                continue;
+            const auto& best = branch[mostSelective(branch)];
+            merged.insert(merged.end(), best.cbegin(), best.cend());
+        }
+
+        result.clear();
+        if (everyBranch)
+        {
+            std::sort(merged.begin(), merged.end());
+            merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+            result.push_back(std::move(merged));
+        }
+        return result;
+    }
+protected:
+    /**
+     * @brief   Parses a sequence of quantified atoms up to '|', ')' or the end.
+     */
+    RequiredLiterals parseSequence()
+    {
+        RequiredLiterals result;
+        std::string run;
+        auto flush = [&]()
+        {
+            if (!run.empty())
+                result.push_back(Alternatives(1, run));
+            run.clear();
+        };
+
+        while (m_pos < m_pattern.size() && m_pattern[m_pos] != '|' && m_pattern[m_pos] != ')')
+        {
+            RequiredLiterals atom;
+            bool isLiteral = false;
+            char literal = 0;
+
+            const char c = m_pattern[m_pos];
+            if (c == '(')
+            {
+                // Lookarounds don't consume their match, don't rely on them.
+                bool lookaround = false;
+                if (++m_pos < m_pattern.size() && m_pattern[m_pos] == '?')
+                    lookaround = parseGroupPrefix();
+                atom = parseAlternation();
+                if (m_pos < m_pattern.size())
+                    ++m_pos;
+                if (lookaround)
+                    atom.clear();
+            }
+            else if (c == '[')
+            {
+                m_pos = skipBracketed(m_pattern, m_pos);
+            }
+            else if (c == '\\')
+            {
+                isLiteral = parseEscape(literal);
+            }
+            else if (c == '.' || c == '^' || c == '$')
+            {
+                ++m_pos;
+            }
+            else
+            {
+                isLiteral = true;
+                literal = c;
+                ++m_pos;
+            }
+
+            bool optional = false;
+            bool repeated = false;
+            parseQuantifier(optional, repeated);
+
+            if (isLiteral && !optional)
+            {
+                run += literal;
+                if (repeated)
+                    flush();
+            }
+            else
+            {
+                flush();
+                if (!optional)
+                    result.insert(result.end(), atom.cbegin(), atom.cend());
+            }
+        }
+
+        flush();
+        return result;
+    }
+
+    /**
+     * @brief   Skips what follows "(?" up to the group's content.
+     * @return  @c true if the group is a lookaround.
+     */
+    bool parseGroupPrefix()
+    {
+        const auto at = [&](size_t offset)
+        {
+            return m_pos + offset < m_pattern.size() ? m_pattern[m_pos + offset] : '\0';
+        };
+
+        const char kind = at(1);
+        if (kind == ':')
+        {
+            m_pos += 2;
+            return false;
+        }
+        if (kind == '=' || kind == '!')
+        {
+            m_pos += 2;
+            return true;
+        }
+        if (kind == '<' && (at(2) == '=' || at(2) == '!'))
+        {
+            m_pos += 3;
+            return true;
+        }
+        if (kind == '<' || kind == '\'' || (kind == 'P' && at(2) == '<'))
+        {
+            // Named group: (?<name>...), (?'name'...) or (?P<name>...).
+            const auto end = m_pattern.find(kind == '\'' ? '\'' : '>', m_pos + 2);
+            m_pos = end == std::string::npos ? m_pattern.size() : end + 1;
+            return false;
+        }
+
+        // Inline flags such as (?i) or (?i:...) of the Perl style backends. Case folding or 
+        // free spacing change what the literals after them match, so nothing is required. The 
+        // same goes for comments, atomic groups, recursion and whatever else starts with "(?".
+        m_inconclusive = true;
+        while (m_pos < m_pattern.size() && m_pattern[m_pos] != ':' && m_pattern[m_pos] != ')')
+            ++m_pos;
+        if (m_pos < m_pattern.size() && m_pattern[m_pos] == ':')
+            ++m_pos;
+        return false;
+    }
+
+    /**
+     * @brief   Parses an escape sequence.
+     * @param   literal Receives the character, if the escape denotes a single one.
+     * @return  @c true if the escape denotes a single character.
+     */
+    bool parseEscape(char& literal)
+    {
+        if (++m_pos >= m_pattern.size())
+            return false;
+
+        const char c = m_pattern[m_pos++];
+        if (isIdentityEscape(c))
+        {
+            literal = c;
+            return true;
+        }
+
+        // Perl style escapes taking an argument, e.g. \p{Lu}, \x{41}, \k<name> or \g{1}.
+        if (std::strchr("pPkgxoN", c) && skipEscapeArgument())
+            return false;
+
+        switch (c)
+        {
+            case 'x':
+                if (m_pos + 2 <= m_pattern.size() 
+                    && std::isxdigit(static_cast<unsigned char>(m_pattern[m_pos]))
+                    && std::isxdigit(static_cast<unsigned char>(m_pattern[m_pos + 1])))
+                {
+                    literal = static_cast<char>(std::stoi(m_pattern.substr(m_pos, 2), 
+                        nullptr, 16));
+                    m_pos += 2;
+                    return true;
+                }
+                return false;
+            case 'u':
+                m_pos = std::min(m_pos + 4, m_pattern.size());
+                return false;
+            case 'c':
+            case 'p':
+            case 'P':
+                // Control characters and Unicode properties with a single letter name.
+                m_pos = std::min(m_pos + 1, m_pattern.size());
+                return false;
+            case 'g':
+                // Relative or absolute back reference, \g1 or \g-1.
+                if (m_pos < m_pattern.size() 
+                    && (m_pattern[m_pos] == '-' || m_pattern[m_pos] == '+'))
+                    ++m_pos;
+                while (m_pos < m_pattern.size() 
+                    && std::isdigit(static_cast<unsigned char>(m_pattern[m_pos])))
+                    ++m_pos;
+                return false;
+            default:
+                // Character classes, assertions and back references.
+                while (std::isdigit(static_cast<unsigned char>(c)) && m_pos < m_pattern.size()
+                    && std::isdigit(static_cast<unsigned char>(m_pattern[m_pos])))
+                    ++m_pos;
+                return false;
+        }
+    }
+
+    /**
+     * @brief   Skips a braced, angled or quoted escape argument of the Perl style backends.
+     *
+     * Such escapes denote classes, code points or back references the analysis doesn't model,
+     * the literals found are discarded then, like for inline flags.
+     *
+     * @return  @c true if there was an argument.
+     */
+    bool skipEscapeArgument()
+    {
+        if (m_pos >= m_pattern.size())
+            return false;
+
+        const char open = m_pattern[m_pos];
+        const char close = open == '{' ? '}' : open == '<' ? '>' : open == '\'' ? '\'' : 0;
+        if (!close)
+            return false;
+
+        const auto end = m_pattern.find(close, m_pos + 1);
+        m_pos = end == std::string::npos ? m_pattern.size() : end + 1;
+        m_inconclusive = true;
+        return true;
+    }
+
+    /**
+     * @brief   Parses the quantifier following an atom, if any.
+     * @param   optional    Set if the atom may be absent.
+     * @param   repeated    Set if the atom may occur more than once.
+     */
+    void parseQuantifier(bool& optional, bool& repeated)
+    {
+        if (m_pos >= m_pattern.size())
+            return;
+
+        const char c = m_pattern[m_pos];
+        if (c == '*' || c == '?' || c == '+')
+        {
+            optional = c != '+';
+            repeated = c != '?';
+            ++m_pos;
+        }
+        else if (c == '{' && m_pos + 1 < m_pattern.size() 
+            && std::isdigit(static_cast<unsigned char>(m_pattern[m_pos + 1])))
+        {
+            size_t end = m_pattern.find('}', m_pos);
+            if (end == std::string::npos)
+                end = m_pattern.size();
+            optional = std::stoul(m_pattern.substr(m_pos + 1)) == 0;
+            repeated = true;
+            m_pos = std::min(end + 1, m_pattern.size());
+        }
+        else
+        {
+            return;
+        }
+
+        // Lazy quantifiers match the same strings.
+        if (m_pos < m_pattern.size() && m_pattern[m_pos] == '?')
+            ++m_pos;
+    }
+};
+
+} // anon namespace
+
+// ============================================================================================== //
+// [PatternAnalysis]                                                                              //
+// ============================================================================================== //
+
+RequiredLiterals requiredLiterals(const std::string& pattern)
+{
+    RequiredLiterals result;
+    Parser parser(pattern);
+    auto required = parser.parseAlternation();
+    if (parser.inconclusive())
+        return result;
+
+    for (auto it = required.begin(), end = required.end(); it != end; ++it)
+    {
+        std::sort(it->begin(), it->end());
+        it->erase(std::unique(it->begin(), it->end()), it->end());
+        if (std::find(result.cbegin(), result.cend(), *it) == result.cend())
+            result.push_back(std::move(*it));
+    }
+    return result;
+}
+
+size_t mostSelective(const RequiredLiterals& required)
+{
+    size_t best = 0;
+    for (size_t i = 1; i < required.size(); ++i)
+    {
+        if (shortestLength(required[i]) > shortestLength(required[best]))
+            best = i;
+    }
+    return best;
+}
+
+Alternatives mangledGuards(const RequiredLiterals& required)
+{
+    RequiredLiterals candidates;
+    for (auto it = required.cbegin(), end = required.cend(); it != end; ++it)
+    {
+        // Every alternative needs a guard, else the rule may apply without any of them.
+        Alternatives guards;
+        for (auto alt = it->cbegin(), altEnd = it->cend(); alt != altEnd; ++alt)
+        {
+            auto guard = mangledGuard(*alt);
+            if (guard.empty())
+                break;
+            guards.push_back(std::move(guard));
+        }
+        if (guards.size() != it->size())
+            continue;
+
+        std::sort(guards.begin(), guards.end());
+        guards.erase(std::unique(guards.begin(), guards.end()), guards.end());
+        candidates.push_back(std::move(guards));
+    }
+
+    return candidates.empty() ? Alternatives() : candidates[mostSelective(candidates)];
+}
+
+bool countCaptureGroups(const std::string& pattern, unsigned& count)
+{
+    count = 0;
+    bool inClass = false;
+    for (size_t pos = 0; pos < pattern.size(); ++pos)
+    {
+        const char c = pattern[pos];
+        if (c == '\\')
+        {
+            // "\Q...\E" quotes parentheses in PCRE2 but not elsewhere.
+            if (++pos < pattern.size() && pattern[pos] == 'Q')
+                return false;
+            continue;
+        }
+
+        if (inClass)
+        {
+            if (c == ']')
+                inClass = false;
+            continue;
+        }
+
+        if (c == '[')
+        {
+            // A leading ']' is literal in Perl syntax but closes the class in ECMAScript.
+            if (pattern.compare(pos + 1, 1, "]") == 0 || pattern.compare(pos + 1, 2, "^]") == 0)
+                return false;
+            inClass = true;
+        }
+        else if (c == '(')
+        {
+            if (pattern.compare(pos + 1, 1, "?") != 0)
+                ++count;
+            else if (pattern.compare(pos + 2, 2, "P<") == 0 || pattern.compare(pos + 2, 1, "'") == 0
+                    || (pattern.compare(pos + 2, 1, "<") == 0 
+                        && pattern.compare(pos + 3, 1, "=") != 0 
+                        && pattern.compare(pos + 3, 1, "!") != 0))
+                ++count;
+        }
+    }
+    return !inClass;
+}
+
+// ============================================================================================== //
+
+}
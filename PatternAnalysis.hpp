@@ -0,0 +1,102 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PATTERNANALYSIS_HPP
+#define PATTERNANALYSIS_HPP
+
+#include <string>
+#include <vector>
+
+// ============================================================================================== //
+// [PatternAnalysis]                                                                              //
+// ============================================================================================== //
+
+/**
+ * @brief   Static analysis of ECMAScript regular expressions as used in rule patterns.
+ */
+namespace PatternAnalysis
+{
+
+/**
+ * @brief   Literals of which at least one must occur in every match.
+ */
+typedef std::vector<std::string> Alternatives;
+/**
+ * @brief   Conjunction of alternatives, all of which must be satisfied by every match.
+ */
+typedef std::vector<Alternatives> RequiredLiterals;
+
+/**
+ * @brief   Determines the literals every match of @c pattern must contain.
+ *
+ * Runs of literal characters are required unless they are made optional by a quantifier or 
+ * an enclosing group is. Alternations contribute a set of alternatives, one literal per
+ * branch, provided that every branch requires one. Lookarounds are ignored. Patterns using 
+ * inline flags such as @c (?i), other group extensions or escapes with an argument such as
+ * @c \p{Lu} or @c \k<name> of the Perl style backends require nothing.
+ *
+ * @param   pattern The regular expression to analyze.
+ * @return  The required literals, empty if none could be proven.
+ */
+RequiredLiterals requiredLiterals(const std::string& pattern);
+
+/**
+ * @brief   Selects the alternatives most selective for prefiltering, those whose shortest 
+ *          literal is longest.
+ * @return  Index into @c required, which must not be empty.
+ */
+size_t mostSelective(const RequiredLiterals& required);
+
+/**
+ * @brief   Derives guards on the mangled form of MSVC names from required literals.
+ *
+ * MSVC manglings spell out identifiers literally (e.g. "?$basic_string@D"), so a fragment of
+ * an identifier a rule requires in the demangled name is present in the mangled name, too.
+ * Keywords, builtin types and the words of special names (such as "`vftable'") are encoded
+ * and never used as guards, neither are numbers.
+ *
+ * @param   required    The literals a rule requires.
+ * @return  Guards of which at least one occurs in the mangled name of every MSVC name the 
+ *          rule can apply to, empty if no such guards can be derived.
+ */
+Alternatives mangledGuards(const RequiredLiterals& required);
+
+/**
+ * @brief   Counts the capture groups of a pattern without compiling it.
+ *
+ * Counts unescaped opening parentheses outside of character classes that are not followed by
+ * '?', plus named groups. Constructs the count could be mistaken for, such as quoted
+ * sequences or classes starting with ']', make it fail.
+ *
+ * @param   pattern The regular expression to analyze.
+ * @param   count   Receives the number of capture groups, excluding group 0.
+ * @return  @c true if the groups could be counted, else @c false.
+ */
+bool countCaptureGroups(const std::string& pattern, unsigned& count);
+
+}
+
+// ============================================================================================== //
+
+#endif // PATTERNANALYSIS_HPP
@@ -0,0 +1,327 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PersistentCache.hpp"
+
+#include "Config.hpp"
+
+#include <cstring>
+#include <vector>
+
+// ============================================================================================== //
+// [PersistentCache]                                                                              //
+// ============================================================================================== //
+
+namespace
+{
+    const char kMagic[8] = { 'R', 'E', 'T', 'D', 'C', 'A', 'C', 'H' };
+    const uint32_t kFormatVersion = 1;
+    const uint32_t kNoText = 0xFFFFFFFF;
+    const uint32_t kRecordAlignment = 4;
+
+    uint32_t alignRecord(uint64_t offset)
+    {
+        return static_cast<uint32_t>((offset + kRecordAlignment - 1) & ~(kRecordAlignment - 1));
+    }
+}
+
+PersistentCache::PersistentCache()
+    : m_pendingTag(0)
+    , m_pendingBytes(0)
+{
+
+}
+
+void PersistentCache::open(const QString& path, uint64_t tag)
+{
+    close();
+    m_mapping.update(map(path, tag));
+
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    m_path = path;
+    m_pendingTag = tag;
+}
+
+void PersistentCache::close()
+{
+    m_mapping.update(nullptr);
+
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    m_path.clear();
+    m_pending.clear();
+    m_pendingBytes = 0;
+}
+
+void PersistentCache::save(uint64_t tag)
+{
+    decltype(m_pending) pending;
+    QString path;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        if (m_path.isEmpty() || m_pendingTag != tag || m_pending.empty())
+            return;
+        pending.swap(m_pending);
+        m_pendingBytes = 0;
+        path = m_path;
+    }
+
+    struct Entry
+    {
+        uint64_t hash;
+        const char* mangled;
+        uint32_t mangledLength;
+        uint32_t disableMask;
+        int32_t ret;
+        const char* text;
+        uint32_t textLength;
+    };
+
+    std::vector<char> image;
+    {
+        Utils::RcuPointer<Mapping>::ReadGuard mapping(m_mapping);
+        std::vector<Entry> entries;
+        entries.reserve(pending.size());
+        for (auto it = pending.cbegin(), end = pending.cend(); it != end; ++it)
+        {
+            const auto& key = it->first;
+            const Entry entry = 
+            {
+                hash(key.mangled.c_str(), key.mangled.size(), key.disableMask),
+                key.mangled.c_str(), static_cast<uint32_t>(key.mangled.size()), 
+                key.disableMask, it->second.ret, 
+                it->second.ret >= 0 ? it->second.text.c_str() : nullptr, 
+                static_cast<uint32_t>(it->second.text.size())
+            };
+            entries.push_back(entry);
+        }
+
+        // Carry over the records of the mapped file not superseded by a recorded result.
+        if (mapping.get() && mapping->header->tag == tag)
+        {
+            for (uint32_t i = 0; i < mapping->header->slotCount; ++i)
+            {
+                const auto& slot = mapping->table[i];
+                auto record = slot.offset ? recordAt(*mapping, slot.offset) : nullptr;
+                if (!record)
+                    continue;
+
+                auto mangled = reinterpret_cast<const char*>(record + 1);
+                const Key key = { std::string(mangled, record->mangledLength), 
+                    record->disableMask };
+                if (pending.count(key))
+                    continue;
+
+                const Entry entry = 
+                {
+                    hash(mangled, record->mangledLength, record->disableMask),
+                    mangled, record->mangledLength, record->disableMask, record->ret,
+                    record->textLength == kNoText ? nullptr : mangled + record->mangledLength,
+                    record->textLength == kNoText ? 0 : record->textLength
+                };
+                entries.push_back(entry);
+            }
+        }
+
+        // Keep the table at most half full, so probe sequences stay short.
+        uint32_t slotCount = 16;
+        while (slotCount < entries.size() * 2)
+            slotCount *= 2;
+
+        uint64_t size = sizeof(Header) + static_cast<uint64_t>(slotCount) * sizeof(Slot);
+        for (auto it = entries.cbegin(), end = entries.cend(); it != end; ++it)
+        {
+            size = alignRecord(size) + sizeof(RecordHeader) + it->mangledLength 
+                + (it->text ? it->textLength + 1 : 0);
+            if (size > 0xFFFFFFF0)
+                throw Error("cache file too large");
+        }
+
+        image.resize(static_cast<size_t>(size));
+        auto header = reinterpret_cast<Header*>(image.data());
+        std::memcpy(header->magic, kMagic, sizeof(kMagic));
+        header->formatVersion = kFormatVersion;
+        header->pluginVersion = PLUGIN_VERSION;
+        header->tag = tag;
+        header->slotCount = slotCount;
+        header->recordCount = static_cast<uint32_t>(entries.size());
+        header->fileSize = size;
+
+        auto table = reinterpret_cast<Slot*>(header + 1);
+        uint32_t offset = sizeof(Header) + slotCount * sizeof(Slot);
+        for (auto it = entries.cbegin(), end = entries.cend(); it != end; ++it)
+        {
+            offset = alignRecord(offset);
+            auto record = reinterpret_cast<RecordHeader*>(image.data() + offset);
+            record->mangledLength = it->mangledLength;
+            record->disableMask = it->disableMask;
+            record->ret = it->ret;
+            record->textLength = it->text ? it->textLength : kNoText;
+            auto payload = reinterpret_cast<char*>(record + 1);
+            std::memcpy(payload, it->mangled, it->mangledLength);
+            if (it->text)
+                std::memcpy(payload + it->mangledLength, it->text, it->textLength + 1);
+
+            auto idx = static_cast<uint32_t>(it->hash) & (slotCount - 1);
+            while (table[idx].offset)
+                idx = (idx + 1) & (slotCount - 1);
+            table[idx].hash = static_cast<uint32_t>(it->hash);
+            table[idx].offset = offset;
+
+            offset += sizeof(RecordHeader) + it->mangledLength 
+                + (it->text ? it->textLength + 1 : 0);
+        }
+
+        header->checksum = Utils::fnv1a(header + 1, image.size() - sizeof(Header));
+    }
+
+    // The mapping has to go before the file can be replaced on Windows. If writing fails, the
+    // previous file is left intact and mapped again.
+    m_mapping.update(nullptr);
+    const bool written = Utils::writeFileAtomically(path, image.data(), image.size());
+    m_mapping.update(map(path, tag));
+    if (!written)
+        throw Error("cannot write cache file");
+}
+
+bool PersistentCache::lookup(const char* mangled, uint32_t disableMask, uint64_t tag, 
+    char* answer, uint32_t answerLength, int32_t& ret) const
+{
+    Utils::RcuPointer<Mapping>::ReadGuard mapping(m_mapping);
+    if (!mapping.get() || mapping->header->tag != tag)
+        return false;
+
+    const size_t length = std::strlen(mangled);
+    const auto fullHash = hash(mangled, length, disableMask);
+    const auto slotHash = static_cast<uint32_t>(fullHash);
+    const auto slotMask = mapping->header->slotCount - 1;
+    for (uint32_t i = 0, idx = slotHash & slotMask; i <= slotMask; ++i, idx = (idx + 1) & slotMask)
+    {
+        const auto& slot = mapping->table[idx];
+        if (!slot.offset)
+            return false;
+        if (slot.hash != slotHash)
+            continue;
+
+        auto record = recordAt(*mapping, slot.offset);
+        if (!record)
+            return false;
+        auto payload = reinterpret_cast<const char*>(record + 1);
+        if (record->mangledLength != length || record->disableMask != disableMask 
+                || std::memcmp(payload, mangled, length) != 0)
+            continue;
+
+        if (record->textLength != kNoText)
+        {
+            if (record->textLength >= answerLength)
+                return false;
+            std::memcpy(answer, payload + length, record->textLength + 1);
+        }
+        ret = record->ret;
+        return true;
+    }
+    return false;
+}
+
+void PersistentCache::record(const char* mangled, uint32_t disableMask, uint64_t tag, 
+    int32_t ret, const char* text)
+{
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    if (m_path.isEmpty() || m_pendingBytes >= kPendingLimit)
+        return;
+    if (tag != m_pendingTag)
+    {
+        // The rules changed, results recorded so far are stale.
+        m_pending.clear();
+        m_pendingBytes = 0;
+        m_pendingTag = tag;
+    }
+
+    Key key = { mangled, disableMask };
+    if (m_pending.count(key))
+        return;
+
+    Result result = { ret, ret >= 0 && text ? text : "" };
+    m_pendingBytes += key.mangled.size() + result.text.size() + sizeof(RecordHeader);
+    m_pending.insert(std::make_pair(std::move(key), std::move(result)));
+}
+
+uint64_t PersistentCache::hash(const char* mangled, size_t length, uint32_t disableMask)
+{
+    return Utils::fnv1a(&disableMask, sizeof(disableMask), Utils::fnv1a(mangled, length));
+}
+
+std::unique_ptr<PersistentCache::Mapping> PersistentCache::map(const QString& path, 
+    uint64_t tag)
+{
+    std::unique_ptr<Mapping> mapping(new Mapping(path));
+    if (!mapping->file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    mapping->size = static_cast<uint64_t>(mapping->file.size());
+    if (mapping->size < sizeof(Header) || mapping->size > 0xFFFFFFFF)
+        return nullptr;
+    mapping->data = mapping->file.map(0, mapping->size);
+    if (!mapping->data)
+        return nullptr;
+
+    auto header = reinterpret_cast<const Header*>(mapping->data);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0
+            || header->formatVersion != kFormatVersion
+            || header->pluginVersion != PLUGIN_VERSION
+            || header->tag != tag
+            || header->fileSize != mapping->size
+            || !header->slotCount || (header->slotCount & (header->slotCount - 1))
+            || header->recordCount >= header->slotCount
+            || sizeof(Header) + static_cast<uint64_t>(header->slotCount) * sizeof(Slot) 
+                > mapping->size)
+        return nullptr;
+
+    // Catches truncated and partially overwritten files the bounds checks would let pass.
+    if (Utils::fnv1a(header + 1, static_cast<size_t>(mapping->size - sizeof(Header))) 
+            != header->checksum)
+        return nullptr;
+
+    mapping->header = header;
+    mapping->table = reinterpret_cast<const Slot*>(header + 1);
+    return mapping;
+}
+
+const PersistentCache::RecordHeader* PersistentCache::recordAt(const Mapping& mapping, 
+    uint32_t offset)
+{
+    if (offset % kRecordAlignment || offset + uint64_t(sizeof(RecordHeader)) > mapping.size)
+        return nullptr;
+
+    auto record = reinterpret_cast<const RecordHeader*>(mapping.data + offset);
+    const uint64_t end = offset + uint64_t(sizeof(RecordHeader)) + record->mangledLength
+        + (record->textLength == kNoText ? 0 : uint64_t(record->textLength) + 1);
+    if (end > mapping.size)
+        return nullptr;
+    if (record->textLength != kNoText 
+            && mapping.data[end - 1] != '\0')
+        return nullptr;
+    return record;
+}
+
+// ============================================================================================== //
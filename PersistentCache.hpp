@@ -0,0 +1,189 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PERSISTENTCACHE_HPP
+#define PERSISTENTCACHE_HPP
+
+#include "Utils.hpp"
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+// ============================================================================================== //
+// [PersistentCache]                                                                              //
+// ============================================================================================== //
+
+/**
+ * @brief   Demangler results kept in a file across sessions.
+ *
+ * The file is memory mapped and holds an open addressing hash table of records, each
+ * mapping a mangled name and disable mask to the substituted result. Lookups read directly 
+ * from the mapping. The file is tagged with the plugin version and a tag identifying the
+ * rules it was produced with; files with a different version or tag, or failing validation,
+ * are ignored and replaced on the next save. Every offset read from the file is bounds 
+ * checked, so a corrupt file can at worst cause misses.
+ *
+ * Results produced during a session are recorded in memory and written on save, along with
+ * the records of the mapped file, to a temporary file that then replaces the old one.
+ */
+class PersistentCache : public Utils::NonCopyable
+{
+public:
+    class Error : public std::runtime_error
+        { public: explicit Error(const char *error) : runtime_error(error) {} };
+protected:
+    struct Header
+    {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t pluginVersion;
+        uint64_t tag;
+        uint32_t slotCount;
+        uint32_t recordCount;
+        uint64_t fileSize;
+        uint64_t checksum;
+    };
+
+    struct Slot
+    {
+        uint32_t hash;
+        // Offset of the record from the start of the file, 0 if the slot is empty.
+        uint32_t offset;
+    };
+
+    // Followed by the mangled name and, if demangling succeeded, the NUL terminated text.
+    struct RecordHeader
+    {
+        uint32_t mangledLength;
+        uint32_t disableMask;
+        int32_t ret;
+        uint32_t textLength;
+    };
+
+    struct Mapping : public Utils::NonCopyable
+    {
+        QFile file;
+        const uchar* data;
+        uint64_t size;
+        const Header* header;
+        const Slot* table;
+
+        explicit Mapping(const QString& path) : file(path), data(nullptr), size(0) {}
+        ~Mapping() { if (data) file.unmap(const_cast<uchar*>(data)); }
+    };
+
+    struct Key
+    {
+        std::string mangled;
+        uint32_t disableMask;
+
+        bool operator == (const Key& other) const
+        {
+            return disableMask == other.disableMask && mangled == other.mangled;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator () (const Key& key) const
+        {
+            return static_cast<size_t>(PersistentCache::hash(key.mangled.c_str(), 
+                key.mangled.size(), key.disableMask));
+        }
+    };
+
+    struct Result
+    {
+        int32_t ret;
+        std::string text;
+    };
+
+    QString m_path;
+    Utils::RcuPointer<Mapping> m_mapping;
+    mutable std::mutex m_pendingMutex;
+    uint64_t m_pendingTag;
+    size_t m_pendingBytes;
+    std::unordered_map<Key, Result, KeyHash> m_pending;
+public:
+    /**
+     * @brief   Upper bound for the results recorded in a session, in bytes. Further results
+     *          are not persisted.
+     */
+    static const size_t kPendingLimit = 64 * 1024 * 1024;
+
+    PersistentCache();
+public:
+    /**
+     * @brief   Maps a cache file. A missing, stale or invalid file is not an error, the cache 
+     *          then starts out empty and the file is created on save.
+     * @param   path    The cache file.
+     * @param   tag     Identifies the rules results are produced with.
+     */
+    void open(const QString& path, uint64_t tag);
+    /**
+     * @brief   Unmaps the file and drops recorded results without saving them.
+     */
+    void close();
+    /**
+     * @brief   Writes the mapped and the recorded results for a tag to the file and maps it.
+     *          Results for other tags are dropped. Does nothing if there is nothing new.
+     * @throws  Error   If the file cannot be written, the recorded results are dropped.
+     */
+    void save(uint64_t tag);
+    bool isOpen() const { return !m_path.isEmpty(); }
+    /**
+     * @brief   Looks up a result.
+     * @param   answerLength    Length of @c answer buffer, a result not fitting is a miss.
+     * @return  @c true on a hit, else @c false.
+     */
+    bool lookup(const char* mangled, uint32_t disableMask, uint64_t tag, 
+        char* answer, uint32_t answerLength, int32_t& ret) const;
+    /**
+     * @brief   Records a result to be persisted on the next save.
+     * @param   text    The substituted name or @c nullptr if demangling failed. Must not be
+     *                  truncated.
+     */
+    void record(const char* mangled, uint32_t disableMask, uint64_t tag, int32_t ret, 
+        const char* text);
+protected:
+    static uint64_t hash(const char* mangled, size_t length, uint32_t disableMask);
+    /**
+     * @brief   Maps and validates a file.
+     * @return  The mapping or @c nullptr if the file is missing, stale or invalid.
+     */
+    static std::unique_ptr<Mapping> map(const QString& path, uint64_t tag);
+    /**
+     * @brief   Returns the bounds checked record at an offset or @c nullptr.
+     */
+    static const RecordHeader* recordAt(const Mapping& mapping, uint32_t offset);
+};
+
+// ============================================================================================== //
+
+#endif // PERSISTENTCACHE_HPP
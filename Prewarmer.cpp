@@ -0,0 +1,145 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Prewarmer.hpp"
+
+#include "Config.hpp"
+
+#include <algorithm>
+#include <ida.hpp>
+#include <kernwin.hpp>
+
+// ============================================================================================== //
+// [Prewarmer]                                                                                    //
+// ============================================================================================== //
+
+namespace
+{
+    const int kProgressIntervalMs = 2000;
+    const std::chrono::milliseconds kForegroundBackoff(1);
+}
+
+Prewarmer::Prewarmer(WarmFunction warm, const std::atomic<unsigned>& foregroundCalls)
+    : m_warm(std::move(warm))
+    , m_foregroundCalls(foregroundCalls)
+    , m_next(0)
+    , m_done(0)
+    , m_activeWorkers(0)
+    , m_cancelled(false)
+    , m_stopped(false)
+{
+    m_progressTimer.setInterval(kProgressIntervalMs);
+    connect(&m_progressTimer, SIGNAL(timeout()), SLOT(reportProgress()));
+}
+
+Prewarmer::~Prewarmer()
+{
+    cancel();
+}
+
+void Prewarmer::start(std::vector<std::string> names)
+{
+    cancel();
+
+    m_names = std::move(names);
+    m_next = 0;
+    m_done = 0;
+    m_cancelled = false;
+    m_stopped = false;
+    m_startTime = std::chrono::steady_clock::now();
+    if (m_names.empty())
+        return;
+
+    const unsigned cores = std::thread::hardware_concurrency();
+    const auto workerCount = std::min<size_t>(std::max(cores, 2U) - 1, m_names.size());
+    m_activeWorkers = static_cast<unsigned>(workerCount);
+    for (size_t i = 0; i < workerCount; ++i)
+        m_workers.emplace_back(&Prewarmer::work, this);
+
+    msg("[" PLUGIN_NAME "] Pre-warming %u names on %u threads.\n", 
+        static_cast<unsigned>(m_names.size()), static_cast<unsigned>(workerCount));
+    m_progressTimer.start();
+}
+
+void Prewarmer::cancel()
+{
+    if (!running())
+        return;
+
+    m_cancelled = true;
+    finish();
+}
+
+void Prewarmer::work()
+{
+    for (;;)
+    {
+        // The demangler hook takes priority, back off while it runs.
+        while (m_foregroundCalls && !m_cancelled)
+            std::this_thread::sleep_for(kForegroundBackoff);
+        if (m_cancelled || m_stopped)
+            break;
+
+        const auto idx = m_next++;
+        if (idx >= m_names.size())
+            break;
+        if (!m_warm(m_names[idx]))
+            m_stopped = true;
+        ++m_done;
+    }
+    --m_activeWorkers;
+}
+
+void Prewarmer::finish()
+{
+    m_progressTimer.stop();
+    for (auto it = m_workers.begin(), end = m_workers.end(); it != end; ++it)
+        it->join();
+    m_workers.clear();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_startTime).count();
+    const char* outcome = m_cancelled ? "cancelled" : (m_stopped ? "stopped early" : "done");
+    msg("[" PLUGIN_NAME "] Pre-warming %s, %u of %u names in %.1f s.\n", outcome,
+        static_cast<unsigned>(m_done), static_cast<unsigned>(m_names.size()), elapsed / 1000.);
+
+    m_names.clear();
+    m_names.shrink_to_fit();
+}
+
+void Prewarmer::reportProgress()
+{
+    if (!m_activeWorkers)
+    {
+        finish();
+        return;
+    }
+
+    const size_t done = m_done;
+    msg("[" PLUGIN_NAME "] Pre-warming names: %u of %u (%u%%)\n", 
+        static_cast<unsigned>(done), static_cast<unsigned>(m_names.size()), 
+        static_cast<unsigned>(done * 100 / m_names.size()));
+}
+
+// ============================================================================================== //
@@ -0,0 +1,106 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PREWARMER_HPP
+#define PREWARMER_HPP
+
+#include "Utils.hpp"
+
+#include <QObject>
+#include <QTimer>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================================== //
+// [Prewarmer]                                                                                    //
+// ============================================================================================== //
+
+/**
+ * @brief   Background job processing a list of names ahead of time.
+ *
+ * The names are distributed over a pool of worker threads, leaving one core to the UI. 
+ * Workers pause while foreground calls are in progress, so the demangler hook is never 
+ * slowed down by the job. Progress is reported to the output window from the UI thread.
+ */
+class Prewarmer : public QObject, public Utils::NonCopyable
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief   Processes a name, called on the worker threads.
+     * @return  @c false to stop the job early.
+     */
+    typedef std::function<bool (const std::string& name)> WarmFunction;
+protected:
+    WarmFunction m_warm;
+    const std::atomic<unsigned>& m_foregroundCalls;
+    std::vector<std::string> m_names;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_next;
+    std::atomic<size_t> m_done;
+    std::atomic<unsigned> m_activeWorkers;
+    std::atomic<bool> m_cancelled;
+    std::atomic<bool> m_stopped;
+    std::chrono::steady_clock::time_point m_startTime;
+    QTimer m_progressTimer;
+public:
+    /**
+     * @brief   Constructor.
+     * @param   warm            Processes a single name.
+     * @param   foregroundCalls Number of foreground calls in progress, workers pause while
+     *                          it is nonzero.
+     */
+    Prewarmer(WarmFunction warm, const std::atomic<unsigned>& foregroundCalls);
+    /**
+     * @brief   Destructor, cancels the job.
+     */
+    ~Prewarmer();
+public:
+    /**
+     * @brief   Starts processing names. Must be called on the UI thread, a job already 
+     *          running is cancelled first.
+     */
+    void start(std::vector<std::string> names);
+    /**
+     * @brief   Cancels the job and waits for the workers to exit.
+     */
+    void cancel();
+    bool running() const { return !m_workers.empty(); }
+protected:
+    void work();
+    /**
+     * @brief   Joins the workers and reports the outcome.
+     */
+    void finish();
+protected slots:
+    void reportProgress();
+};
+
+// ============================================================================================== //
+
+#endif // PREWARMER_HPP
@@ -0,0 +1,471 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RegexBackend.hpp"
+
+#include "ScratchArena.hpp"
+
+#include <mutex>
+#include <regex>
+
+#ifdef RETYPEDEF_WITH_RE2
+#   include <re2/re2.h>
+#endif
+
+#ifdef RETYPEDEF_WITH_PCRE2
+#   define PCRE2_CODE_UNIT_WIDTH 8
+#   include <pcre2.h>
+#endif
+
+namespace
+{
+
+// ============================================================================================== //
+// [StdRegexMatcher]                                                                              //
+// ============================================================================================== //
+
+/**
+ * @brief   Reference backend based on @c std::regex (ECMAScript grammar).
+ */
+class StdRegexMatcher : public Matcher
+{
+    std::regex m_regex;
+public:
+    explicit StdRegexMatcher(const std::string& pattern)
+    {
+        try
+        {
+            m_regex = std::regex(pattern, std::regex_constants::optimize);
+        }
+        catch (const std::regex_error& e)
+        {
+            throw Error(e.what());
+        }
+
+        if (m_regex.mark_count() >= MatchGroups::kMaxGroups)
+            throw Error("too many capture groups");
+    }
+
+    unsigned groupCount() const override
+    {
+        return static_cast<unsigned>(m_regex.mark_count());
+    }
+
+    bool match(const char* begin, const char* end, MatchGroups& groups) const override
+    {
+        auto& results = ScratchArena::local().stdGroups();
+        if (!std::regex_match(begin, end, results, m_regex))
+            return false;
+
+        copyGroups(results, groups);
+        return true;
+    }
+
+    bool search(const char* begin, const char* end, const char* from, 
+        MatchGroups& groups) const override
+    {
+        auto& results = ScratchArena::local().stdGroups();
+        const auto flags = from != begin ? std::regex_constants::match_prev_avail 
+            : std::regex_constants::match_default;
+        if (!std::regex_search(from, end, results, m_regex, flags))
+            return false;
+
+        copyGroups(results, groups);
+        return true;
+    }
+private:
+    static void copyGroups(const std::cmatch& results, MatchGroups& groups)
+    {
+        groups.resize(static_cast<unsigned>(results.size()));
+        for (unsigned i = 0; i < groups.size(); ++i)
+        {
+            MatchSpan span = { nullptr, nullptr };
+            if (results[i].matched)
+            {
+                span.begin = results[i].first;
+                span.end = results[i].second;
+            }
+            groups[i] = span;
+        }
+    }
+};
+
+// ============================================================================================== //
+// [Re2Matcher]                                                                                   //
+// ============================================================================================== //
+
+#ifdef RETYPEDEF_WITH_RE2
+
+/**
+ * @brief   Linear-time backend based on RE2.
+ */
+class Re2Matcher : public Matcher
+{
+    RE2 m_regex;
+public:
+    explicit Re2Matcher(const std::string& pattern)
+        : m_regex(pattern, RE2::Quiet)
+    {
+        if (!m_regex.ok())
+            throw Error(m_regex.error());
+        if (groupCount() >= MatchGroups::kMaxGroups)
+            throw Error("too many capture groups");
+    }
+
+    unsigned groupCount() const override
+    {
+        return static_cast<unsigned>(m_regex.NumberOfCapturingGroups());
+    }
+
+    bool match(const char* begin, const char* end, MatchGroups& groups) const override
+    {
+        return find(begin, end, begin, RE2::ANCHOR_BOTH, groups);
+    }
+
+    bool search(const char* begin, const char* end, const char* from, 
+        MatchGroups& groups) const override
+    {
+        return find(begin, end, from, RE2::UNANCHORED, groups);
+    }
+private:
+    bool find(const char* begin, const char* end, const char* from, RE2::Anchor anchor, 
+        MatchGroups& groups) const
+    {
+        re2::StringPiece pieces[MatchGroups::kMaxGroups];
+        const auto count = static_cast<int>(groupCount() + 1);
+        re2::StringPiece text(begin, static_cast<int>(end - begin));
+        if (!m_regex.Match(text, from - begin, text.size(), anchor, pieces, count))
+            return false;
+
+        groups.resize(count);
+        for (int i = 0; i < count; ++i)
+        {
+            MatchSpan span = { nullptr, nullptr };
+            if (pieces[i].data())
+            {
+                span.begin = pieces[i].data();
+                span.end = pieces[i].data() + pieces[i].size();
+            }
+            groups[i] = span;
+        }
+        return true;
+    }
+};
+
+#endif // RETYPEDEF_WITH_RE2
+
+// ============================================================================================== //
+// [Pcre2Matcher]                                                                                 //
+// ============================================================================================== //
+
+#ifdef RETYPEDEF_WITH_PCRE2
+
+/**
+ * @brief   JIT-compiled backend based on PCRE2 (10.30 or newer).
+ */
+class Pcre2Matcher : public Matcher
+{
+    // JIT code does not support anchoring options at match time, hence two compilations.
+    pcre2_code* m_code;
+    pcre2_code* m_searchCode;
+    unsigned m_groupCount;
+
+    /**
+     * @brief   Match data of the calling thread, large enough for any pattern.
+     */
+    static pcre2_match_data* localMatchData()
+    {
+        struct Holder
+        {
+            pcre2_match_data* data;
+            Holder() : data(pcre2_match_data_create(MatchGroups::kMaxGroups, nullptr)) {}
+            ~Holder() { pcre2_match_data_free(data); }
+        };
+        static thread_local Holder holder;
+        return holder.data;
+    }
+
+    /**
+     * @brief   Compiles and JIT-compiles a pattern.
+     */
+    static pcre2_code* compileCode(const std::string& pattern, uint32_t options)
+    {
+        int errorCode;
+        PCRE2_SIZE errorOffset;
+        auto code = pcre2_compile(reinterpret_cast<PCRE2_SPTR>(pattern.data()), pattern.size(),
+            options, &errorCode, &errorOffset, nullptr);
+        if (!code)
+        {
+            PCRE2_UCHAR message[256];
+            pcre2_get_error_message(errorCode, message, sizeof(message));
+            throw Error(reinterpret_cast<const char*>(message));
+        }
+
+        // If JIT is unsupported on this platform, matching falls back to the interpreter.
+        pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+        return code;
+    }
+public:
+    explicit Pcre2Matcher(const std::string& pattern)
+        : m_code(compileCode(pattern, PCRE2_ANCHORED | PCRE2_ENDANCHORED))
+        , m_searchCode(nullptr)
+        , m_groupCount(0)
+    {
+        uint32_t captureCount = 0;
+        pcre2_pattern_info(m_code, PCRE2_INFO_CAPTURECOUNT, &captureCount);
+        if (captureCount >= MatchGroups::kMaxGroups)
+        {
+            pcre2_code_free(m_code);
+            throw Error("too many capture groups");
+        }
+        m_groupCount = captureCount;
+
+        try
+        {
+            m_searchCode = compileCode(pattern, 0);
+        }
+        catch (...)
+        {
+            pcre2_code_free(m_code);
+            throw;
+        }
+    }
+
+    ~Pcre2Matcher()
+    {
+        pcre2_code_free(m_searchCode);
+        pcre2_code_free(m_code);
+    }
+
+    unsigned groupCount() const override
+    {
+        return m_groupCount;
+    }
+
+    bool match(const char* begin, const char* end, MatchGroups& groups) const override
+    {
+        return find(m_code, begin, end, begin, groups);
+    }
+
+    bool search(const char* begin, const char* end, const char* from, 
+        MatchGroups& groups) const override
+    {
+        return find(m_searchCode, begin, end, from, groups);
+    }
+private:
+    bool find(const pcre2_code* code, const char* begin, const char* end, const char* from, 
+        MatchGroups& groups) const
+    {
+        auto data = localMatchData();
+        int rc = pcre2_match(code, reinterpret_cast<PCRE2_SPTR>(begin), end - begin, 
+            from - begin, 0, data, nullptr);
+        if (rc <= 0)
+            return false;
+
+        const auto ovector = pcre2_get_ovector_pointer(data);
+        groups.resize(m_groupCount + 1);
+        for (unsigned i = 0; i < groups.size(); ++i)
+        {
+            MatchSpan span = { nullptr, nullptr };
+            if (i < static_cast<unsigned>(rc) && ovector[2 * i] != PCRE2_UNSET)
+            {
+                span.begin = begin + ovector[2 * i];
+                span.end = begin + ovector[2 * i + 1];
+            }
+            groups[i] = span;
+        }
+        return true;
+    }
+};
+
+#endif // RETYPEDEF_WITH_PCRE2
+
+// ============================================================================================== //
+// [LazyMatcher]                                                                                  //
+// ============================================================================================== //
+
+/**
+ * @brief   Compiles its pattern on first use. The group layout is known in advance, so the
+ *          rule's replacement can be prepared without compiling.
+ */
+class LazyMatcher : public Matcher
+{
+    RegexBackend::Kind m_kind;
+    std::string m_pattern;
+    unsigned m_groupCount;
+    std::vector<std::string> m_groupNames;
+    RegexBackend::ErrorHandler m_onError;
+    mutable std::once_flag m_compileFlag;
+    mutable std::shared_ptr<const Matcher> m_compiled;
+public:
+    LazyMatcher(RegexBackend::Kind kind, const std::string& pattern, unsigned groupCount, 
+            const std::vector<std::string>& groupNames, RegexBackend::ErrorHandler onError)
+        : m_kind(kind)
+        , m_pattern(pattern)
+        , m_groupCount(groupCount)
+        , m_groupNames(groupNames)
+        , m_onError(std::move(onError))
+    {
+
+    }
+
+    unsigned groupCount() const override
+    {
+        return m_groupCount;
+    }
+
+    const std::vector<std::string>& groupNames() const override
+    {
+        return m_groupNames;
+    }
+
+    bool match(const char* begin, const char* end, MatchGroups& groups) const override
+    {
+        auto compiled = this->compiled();
+        return compiled && compiled->match(begin, end, groups);
+    }
+
+    bool search(const char* begin, const char* end, const char* from, 
+        MatchGroups& groups) const override
+    {
+        auto compiled = this->compiled();
+        return compiled && compiled->search(begin, end, from, groups);
+    }
+private:
+    /**
+     * @brief   Returns the compiled pattern, @c nullptr if it turned out to be invalid or to
+     *          have different groups than announced. The pattern never matches then.
+     */
+    const Matcher* compiled() const
+    {
+        std::call_once(m_compileFlag, [this]
+        {
+            try
+            {
+                auto compiled = RegexBackend::compile(m_kind, m_pattern);
+                if (compiled->groupCount() != m_groupCount)
+                    throw Error("capture groups differ from the ones announced");
+                m_compiled = std::move(compiled);
+            }
+            catch (const Error& e)
+            {
+                if (m_onError)
+                    m_onError(m_pattern, e.what());
+            }
+        });
+        return m_compiled.get();
+    }
+};
+
+} // anon namespace
+
+// ============================================================================================== //
+// [Matcher]                                                                                      //
+// ============================================================================================== //
+
+const std::vector<std::string>& Matcher::groupNames() const
+{
+    static const std::vector<std::string> kNoNames;
+    return kNoNames;
+}
+
+// ============================================================================================== //
+// [RegexBackend]                                                                                 //
+// ============================================================================================== //
+
+std::shared_ptr<const Matcher> RegexBackend::compile(Kind kind, const std::string& pattern)
+{
+    switch (kind)
+    {
+        case kStdRegex:
+            return std::make_shared<StdRegexMatcher>(pattern);
+#ifdef RETYPEDEF_WITH_RE2
+        case kRe2:
+            return std::make_shared<Re2Matcher>(pattern);
+#endif
+#ifdef RETYPEDEF_WITH_PCRE2
+        case kPcre2:
+            return std::make_shared<Pcre2Matcher>(pattern);
+#endif
+        default:
+            throw Matcher::Error(std::string("regex backend \"") + name(kind) 
+                + "\" is not available in this build");
+    }
+}
+
+std::shared_ptr<const Matcher> RegexBackend::compileLazily(Kind kind, 
+    const std::string& pattern, unsigned groupCount, const std::vector<std::string>& groupNames,
+    ErrorHandler onError)
+{
+    if (!isAvailable(kind))
+        throw Matcher::Error(std::string("regex backend \"") + name(kind) 
+            + "\" is not available in this build");
+    return std::make_shared<LazyMatcher>(kind, pattern, groupCount, groupNames, 
+        std::move(onError));
+}
+
+bool RegexBackend::isAvailable(Kind kind)
+{
+    switch (kind)
+    {
+        case kStdRegex:
+            return true;
+#ifdef RETYPEDEF_WITH_RE2
+        case kRe2:
+            return true;
+#endif
+#ifdef RETYPEDEF_WITH_PCRE2
+        case kPcre2:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* RegexBackend::name(Kind kind)
+{
+    switch (kind)
+    {
+        case kStdRegex:
+            return "std";
+        case kRe2:
+            return "re2";
+        case kPcre2:
+            return "pcre2";
+        default:
+            return "unknown";
+    }
+}
+
+RegexBackend::Kind RegexBackend::fromName(const std::string& name)
+{
+    if (name == "re2")
+        return kRe2;
+    if (name == "pcre2")
+        return kPcre2;
+    return kStdRegex;
+}
+
+// ============================================================================================== //
@@ -0,0 +1,177 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef REGEXBACKEND_HPP
+#define REGEXBACKEND_HPP
+
+#include "Utils.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// ============================================================================================== //
+// [MatchGroups]                                                                                  //
+// ============================================================================================== //
+
+/**
+ * @brief   Span of a capture group, null pointers denote a group that did not participate.
+ */
+struct MatchSpan
+{
+    const char* begin;
+    const char* end;
+
+    bool matched() const { return begin != nullptr; }
+};
+
+/**
+ * @brief   Fixed-capacity capture group storage shared by all backends.
+ */
+class MatchGroups
+{
+public:
+    /**
+     * @brief   Maximum number of groups, including the implicit group 0.
+     */
+    static const unsigned kMaxGroups = 32;
+private:
+    MatchSpan m_spans[kMaxGroups];
+    unsigned m_size;
+public:
+    MatchGroups() : m_size(0) {}
+public:
+    unsigned size() const { return m_size; }
+    void resize(unsigned size) { m_size = size; }
+    MatchSpan& operator [] (unsigned idx) { return m_spans[idx]; }
+    const MatchSpan& operator [] (unsigned idx) const { return m_spans[idx]; }
+};
+
+// ============================================================================================== //
+// [Matcher]                                                                                      //
+// ============================================================================================== //
+
+/**
+ * @brief   A compiled pattern of one of the regular expression backends.
+ */
+class Matcher : public Utils::NonCopyable
+{
+public:
+    class Error : public std::runtime_error
+        { public: explicit Error(const std::string& error) : runtime_error(error) {} };
+public:
+    virtual ~Matcher() {}
+    /**
+     * @brief   Returns the number of capture groups, excluding group 0.
+     */
+    virtual unsigned groupCount() const = 0;
+    /**
+     * @brief   Returns the names of the capture groups by index minus one, possibly fewer.
+     */
+    virtual const std::vector<std::string>& groupNames() const;
+    /**
+     * @brief   Matches the pattern against the entire range.
+     * @param   begin   Start of the subject.
+     * @param   end     End of the subject.
+     * @param   groups  Receives group 0 and the capture groups on success.
+     * @return  @c true if the pattern matched, else @c false.
+     */
+    virtual bool match(const char* begin, const char* end, MatchGroups& groups) const = 0;
+    /**
+     * @brief   Finds the leftmost match starting at or after a position.
+     * @param   begin   Start of the subject.
+     * @param   end     End of the subject.
+     * @param   from    Where to start searching, the text before it is still visible to
+     *                  anchors and word boundaries.
+     * @param   groups  Receives group 0 and the capture groups on success.
+     * @return  @c true if a match was found, else @c false.
+     */
+    virtual bool search(const char* begin, const char* end, const char* from, 
+        MatchGroups& groups) const = 0;
+};
+
+// ============================================================================================== //
+// [RegexBackend]                                                                                 //
+// ============================================================================================== //
+
+/**
+ * @brief   Factory for the available regular expression backends.
+ *
+ * All backends accept the common subset of ECMAScript and Perl syntax the rules are written in
+ * and report capture groups identically, so a rule set can be moved between them freely.
+ */
+class RegexBackend
+{
+public:
+    enum Kind
+    {
+        kStdRegex,
+        kRe2,
+        kPcre2
+    };
+public:
+    /**
+     * @brief   Compiles a pattern.
+     * @param   kind    The backend to use.
+     * @param   pattern The pattern.
+     * @return  The compiled pattern.
+     * @throws  Matcher::Error  If the pattern is invalid or the backend is unavailable.
+     */
+    static std::shared_ptr<const Matcher> compile(Kind kind, const std::string& pattern);
+    /**
+     * @brief   Receives the error of a lazily compiled pattern.
+     */
+    typedef std::function<void (const std::string& pattern, const std::string& error)> 
+        ErrorHandler;
+    /**
+     * @brief   Returns a matcher compiling a pattern on first use.
+     * 
+     * If the pattern turns out to be invalid or to have other groups than announced, the 
+     * matcher never matches.
+     * 
+     * @param   groupCount  The pattern's number of capture groups.
+     * @param   groupNames  The pattern's group names, see Matcher::groupNames.
+     * @param   onError     Called from the thread first using the matcher if compilation 
+     *                      fails, optional.
+     * @throws  Matcher::Error  If the backend is unavailable.
+     */
+    static std::shared_ptr<const Matcher> compileLazily(Kind kind, const std::string& pattern,
+        unsigned groupCount, const std::vector<std::string>& groupNames, 
+        ErrorHandler onError = ErrorHandler());
+    /**
+     * @brief   Determines whether support for a backend was compiled in.
+     */
+    static bool isAvailable(Kind kind);
+    static const char* name(Kind kind);
+    /**
+     * @brief   Looks up a backend by its name, falling back to @c kStdRegex.
+     */
+    static Kind fromName(const std::string& name);
+};
+
+// ============================================================================================== //
+
+#endif // REGEXBACKEND_HPP
@@ -0,0 +1,187 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ReplacementTemplate.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// ============================================================================================== //
+// [ReplacementTemplate]                                                                          //
+// ============================================================================================== //
+
+ReplacementTemplate::ReplacementTemplate()
+{
+    
+}
+
+ReplacementTemplate::ReplacementTemplate(const std::string& replacement, unsigned groupCount,
+    const std::vector<std::string>& groupNames)
+{
+    auto addLiteral = [this](const char* begin, const char* end)
+    {
+        if (begin == end)
+            return;
+
+        // Merge with a directly preceding literal.
+        if (!m_parts.empty() && m_parts.back().group < 0)
+        {
+            m_parts.back().length += static_cast<uint32_t>(end - begin);
+        }
+        else
+        {
+            Part part = { static_cast<uint32_t>(m_literals.size()), 
+                static_cast<uint32_t>(end - begin), -1 };
+            m_parts.push_back(part);
+        }
+        m_literals.append(begin, end);
+    };
+
+    const char* cur = replacement.c_str();
+    const char* end = cur + replacement.size();
+    const char* literalStart = cur;
+    while (cur != end)
+    {
+        if (*cur != '$')
+        {
+            ++cur;
+            continue;
+        }
+
+        // A name refers to the group of that name.
+        const char* nameEnd = cur + 1;
+        while (nameEnd != end && (std::isalnum(static_cast<unsigned char>(*nameEnd)) 
+                || *nameEnd == '_'))
+            ++nameEnd;
+        if (nameEnd != cur + 1 && !std::isdigit(static_cast<unsigned char>(cur[1])))
+        {
+            const std::string name(cur + 1, nameEnd);
+            auto named = std::find(groupNames.cbegin(), groupNames.cend(), name);
+            if (named == groupNames.cend())
+            {
+                ++cur;
+                continue;
+            }
+
+            addLiteral(literalStart, cur);
+            Part part = { 0, 0, static_cast<int>(named - groupNames.cbegin()) + 1 };
+            m_parts.push_back(part);
+            cur = literalStart = nameEnd;
+            continue;
+        }
+
+        // Find the longest digit sequence naming an existing group.
+        const char* digitsEnd = cur + 1;
+        while (digitsEnd != end && std::isdigit(static_cast<unsigned char>(*digitsEnd)))
+            ++digitsEnd;
+
+        int group = -1;
+        for (; digitsEnd != cur + 1; --digitsEnd)
+        {
+            unsigned value = 0;
+            for (const char* digit = cur + 1; digit != digitsEnd; ++digit)
+            {
+                value = value * 10 + (*digit - '0');
+                if (value > groupCount)
+                    break;
+            }
+
+            if (value <= groupCount)
+            {
+                group = static_cast<int>(value);
+                break;
+            }
+        }
+
+        if (group < 0)
+        {
+            ++cur;
+            continue;
+        }
+
+        addLiteral(literalStart, cur);
+        Part part = { 0, 0, group };
+        m_parts.push_back(part);
+        cur = literalStart = digitsEnd;
+    }
+    addLiteral(literalStart, end);
+}
+
+void ReplacementTemplate::expand(const MatchGroups& groups, std::string& out) const
+{
+    for (auto it = m_parts.cbegin(), end = m_parts.cend(); it != end; ++it)
+    {
+        if (it->group < 0)
+        {
+            out.append(m_literals, it->offset, it->length);
+        }
+        else if (static_cast<unsigned>(it->group) < groups.size() 
+            && groups[it->group].matched())
+        {
+            out.append(groups[it->group].begin, groups[it->group].end);
+        }
+    }
+}
+
+bool ReplacementTemplate::joinsText() const
+{
+    if (m_parts.empty() || m_parts.front().group >= 0 || m_parts.back().group >= 0)
+        return true;
+
+    for (auto it = m_parts.cbegin(), end = m_parts.cend(); it + 1 < end; ++it)
+    {
+        if (it->group >= 0 && (it + 1)->group >= 0)
+            return true;
+    }
+    return false;
+}
+
+bool ReplacementTemplate::mayProduce(const std::string& literal) const
+{
+    if (joinsText())
+        return true;
+
+    for (auto it = m_parts.cbegin(), end = m_parts.cend(); it != end; ++it)
+    {
+        if (it->group >= 0)
+            continue;
+
+        // Contained in the span, or sticking out of it on either side.
+        const char* span = m_literals.data() + it->offset;
+        const size_t spanLength = it->length;
+        for (size_t shift = 1; shift < literal.size() + spanLength; ++shift)
+        {
+            const size_t spanBegin = shift < literal.size() ? 0 : shift - literal.size();
+            const size_t literalBegin = shift < literal.size() ? literal.size() - shift : 0;
+            const size_t overlap = std::min(spanLength - spanBegin, 
+                literal.size() - literalBegin);
+            if (::memcmp(span + spanBegin, literal.data() + literalBegin, overlap) == 0)
+                return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================================== //
@@ -0,0 +1,89 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef REPLACEMENTTEMPLATE_HPP
+#define REPLACEMENTTEMPLATE_HPP
+
+#include "RegexBackend.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================================== //
+// [ReplacementTemplate]                                                                          //
+// ============================================================================================== //
+
+/**
+ * @brief   Pre-parsed replacement string.
+ *
+ * The replacement is split into literal spans and references to capture groups ("$N") once,
+ * expanding it is a single linear write. A reference consumes the longest digit sequence that
+ * names an existing group, so "$10" refers to group 10 only if the pattern has 10 groups and
+ * to group 1 followed by a literal "0" otherwise. Named groups are referred to as "$Name". 
+ * References to groups that don't exist are kept as literal text.
+ */
+class ReplacementTemplate
+{
+    struct Part
+    {
+        uint32_t offset;
+        uint32_t length;
+        int group;
+    };
+
+    std::string m_literals;
+    std::vector<Part> m_parts;
+public:
+    ReplacementTemplate();
+    /**
+     * @brief   Constructor.
+     * @param   replacement The replacement string.
+     * @param   groupCount  Number of capture groups in the pattern (excluding group 0).
+     * @param   groupNames  Names of the capture groups, starting with group 1.
+     */
+    ReplacementTemplate(const std::string& replacement, unsigned groupCount, 
+        const std::vector<std::string>& groupNames = std::vector<std::string>());
+public:
+    /**
+     * @brief   Appends the expansion of the template for a match to @c out.
+     */
+    void expand(const MatchGroups& groups, std::string& out) const;
+    /**
+     * @brief   Determines whether an expansion places captured or surrounding text next to
+     *          text it wasn't adjacent to before, which may create arbitrary new text.
+     *          That is the case for an empty template, a group reference at either end and 
+     *          adjacent group references.
+     */
+    bool joinsText() const;
+    /**
+     * @brief   Determines whether an expansion may create a new occurrence of a literal, i.e.
+     *          joinsText() is @c true or the literal overlaps one of the literal spans.
+     */
+    bool mayProduce(const std::string& literal) const;
+};
+
+// ============================================================================================== //
+
+#endif // REPLACEMENTTEMPLATE_HPP
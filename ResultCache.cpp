@@ -0,0 +1,281 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ResultCache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+// ============================================================================================== //
+// [ResultCache]                                                                                  //
+// ============================================================================================== //
+
+namespace
+{
+    // Rough per-entry bookkeeping overhead of the list and hash map nodes.
+    const size_t kEntryOverhead = 64;
+    // Rough overhead of a rule recorded for an entry, including its node in the reverse index.
+    const size_t kRewriteOverhead = 48;
+
+    /**
+     * @brief   Returns a trace listing every rule once.
+     */
+    RewriteTrace condensed(const RewriteTrace& trace)
+    {
+        RewriteTrace result = trace;
+        std::sort(result.rules.begin(), result.rules.end());
+        result.rules.erase(std::unique(result.rules.begin(), result.rules.end()), 
+            result.rules.end());
+        return result;
+    }
+
+    size_t traceCost(const RewriteTrace& trace)
+    {
+        size_t cost = trace.rules.size() * kRewriteOverhead;
+        for (auto it = trace.elidedFrom.cbegin(), end = trace.elidedFrom.cend(); it != end; ++it)
+            cost += sizeof(*it) + it->size();
+        return cost;
+    }
+}
+
+ResultCache::ResultCache(size_t memoryLimit)
+    : m_memoryLimit(memoryLimit)
+    , m_memoryUsage(0)
+    , m_evictions(0)
+{
+    
+}
+
+bool ResultCache::lookup(const char* mangled, uint32_t disableMask, uint32_t generation,
+    char* answer, uint32_t answerLength, int32_t& ret)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const Key key = { mangled, ::strlen(mangled), disableMask, false };
+    auto entry = find(key, generation);
+    if (entry == m_entries.end())
+        return false;
+
+    // A result truncated to a smaller buffer cannot serve a larger one, and vice versa.
+    const bool truncated = entry->text.size() + 1 >= entry->bufferLength;
+    if (entry->ret >= 0 && (entry->text.size() >= answerLength 
+            || (truncated && entry->bufferLength != answerLength)))
+        return false;
+
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+    ret = entry->ret;
+    if (ret >= 0)
+        ::memcpy(answer, entry->text.c_str(), entry->text.size() + 1);
+    return true;
+}
+
+void ResultCache::insert(const char* mangled, uint32_t disableMask, uint32_t generation,
+    int32_t ret, const char* text, uint32_t answerLength, const RewriteTrace& trace)
+{
+    Entry entry;
+    entry.mangled = mangled;
+    entry.disableMask = disableMask;
+    entry.structured = false;
+    entry.generation = generation;
+    entry.ret = text ? ret : (ret >= 0 ? -1 : ret);
+    if (text)
+        entry.text = text;
+    entry.bufferLength = answerLength;
+    entry.trace = condensed(trace);
+    entry.rewritten = !trace.rules.empty() || !trace.elidedFrom.empty();
+    entry.cost = sizeof(Entry) + kEntryOverhead + entry.mangled.size() + entry.text.size() 
+        + traceCost(entry.trace);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    store(std::move(entry));
+}
+
+bool ResultCache::lookupVariant(const char* mangled, uint32_t disableMask, char* answer, 
+    uint32_t answerLength, int32_t& ret)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const Key key = { mangled, ::strlen(mangled), DemangledForm::baseMask(disableMask), true };
+    auto entry = find(key, 0);
+    if (entry == m_entries.end())
+        return false;
+    if (entry->ret >= 0 && !entry->form.render(disableMask, answer, answerLength))
+        return false;
+
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+    ret = entry->ret;
+    return true;
+}
+
+void ResultCache::insertForm(const char* mangled, uint32_t baseMask, int32_t ret, 
+    const DemangledForm* form)
+{
+    Entry entry;
+    entry.mangled = mangled;
+    entry.disableMask = baseMask;
+    entry.structured = true;
+    entry.generation = 0;
+    entry.ret = form ? ret : (ret >= 0 ? -1 : ret);
+    if (form)
+        entry.form = *form;
+    entry.bufferLength = 0;
+    entry.rewritten = false;
+    entry.cost = sizeof(Entry) + kEntryOverhead + entry.mangled.size() + entry.form.cost();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    store(std::move(entry));
+}
+
+size_t ResultCache::carryOver(uint32_t from, uint32_t to, 
+    const std::vector<const Substitution*>& removed, const ChangePredicate& mayChange)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t dropped = 0;
+    for (auto rule = removed.cbegin(), end = removed.cend(); rule != end; ++rule)
+    {
+        auto rewrites = m_rewrites.find(*rule);
+        if (rewrites == m_rewrites.end())
+            continue;
+
+        // Erasing the entries shrinks the set.
+        const std::vector<const Entry*> entries(rewrites->second.cbegin(), 
+            rewrites->second.cend());
+        for (auto it = entries.cbegin(), entriesEnd = entries.cend(); it != entriesEnd; ++it)
+        {
+            erase(m_index.find((*it)->key())->second);
+            ++dropped;
+        }
+    }
+
+    for (auto it = m_entries.begin(), end = m_entries.end(); it != end;)
+    {
+        auto entry = it++;
+        if (entry->structured || entry->generation != from)
+            continue;
+
+        if (entry->ret >= 0 && mayChange(entry->mangled.c_str(), entry->text, entry->trace))
+        {
+            erase(entry);
+            ++dropped;
+        }
+        else
+        {
+            entry->generation = to;
+        }
+    }
+    return dropped;
+}
+
+void ResultCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_index.clear();
+    m_rewrites.clear();
+    m_entries.clear();
+    m_memoryUsage = 0;
+}
+
+void ResultCache::setMemoryLimit(size_t memoryLimit)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memoryLimit = memoryLimit;
+    evict();
+}
+
+size_t ResultCache::memoryLimit() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryLimit;
+}
+
+size_t ResultCache::memoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryUsage;
+}
+
+size_t ResultCache::evictions() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_evictions;
+}
+
+ResultCache::EntryList::iterator ResultCache::find(const Key& key, uint32_t generation)
+{
+    auto it = m_index.find(key);
+    if (it == m_index.end())
+        return m_entries.end();
+
+    auto entry = it->second;
+    if (!key.structured && entry->generation != generation)
+    {
+        erase(entry);
+        return m_entries.end();
+    }
+    return entry;
+}
+
+void ResultCache::store(Entry entry)
+{
+    auto it = m_index.find(entry.key());
+    if (it != m_index.end())
+        erase(it->second);
+
+    m_entries.push_front(std::move(entry));
+    const auto& stored = m_entries.front();
+    m_index.insert(std::make_pair(stored.key(), m_entries.begin()));
+    for (auto rule = stored.trace.rules.cbegin(), end = stored.trace.rules.cend(); 
+            rule != end; ++rule)
+        m_rewrites[*rule].insert(&stored);
+    m_memoryUsage += stored.cost;
+    evict();
+}
+
+void ResultCache::evict()
+{
+    while (m_memoryUsage > m_memoryLimit && !m_entries.empty())
+    {
+        erase(std::prev(m_entries.end()));
+        ++m_evictions;
+    }
+}
+
+void ResultCache::erase(EntryList::iterator entry)
+{
+    for (auto rule = entry->trace.rules.cbegin(), end = entry->trace.rules.cend(); 
+        rule != end; ++rule)
+    {
+        auto rewrites = m_rewrites.find(*rule);
+        rewrites->second.erase(&*entry);
+        if (rewrites->second.empty())
+            m_rewrites.erase(rewrites);
+    }
+    m_memoryUsage -= entry->cost;
+    m_index.erase(entry->key());
+    m_entries.erase(entry);
+}
+
+// ============================================================================================== //
@@ -0,0 +1,209 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RESULTCACHE_HPP
+#define RESULTCACHE_HPP
+
+#include "Utils.hpp"
+#include "DemangledForm.hpp"
+#include "RuleSet.hpp"
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ============================================================================================== //
+// [ResultCache]                                                                                  //
+// ============================================================================================== //
+
+/**
+ * @brief   Bounded LRU cache memoizing the results of the demangler hook.
+ *
+ * Entries are keyed by the mangled name and the disable mask and tagged with the rule set
+ * generation they were produced with. Bumping the generation invalidates all results at
+ * once, stale entries are dropped when they are next looked up or age out.
+ *
+ * Besides the substituted results, the cache holds DemangledForm entries keyed by the base
+ * mask they were demangled with. They hold the demangler's output before any rule ran, so
+ * they serve every mask sharing that base regardless of the rules and survive rule changes.
+ *
+ * Every entry also records the rules that rewrote it, indexed by rule, so that after a rule
+ * change the entries it cannot affect can be carried over to the new generation instead.
+ */
+class ResultCache : public Utils::NonCopyable
+{
+    // Refers to the name rather than holding a copy, so lookups don't allocate.
+    struct Key
+    {
+        // The entry's mangled name, or the caller's for lookups.
+        const char* mangled;
+        size_t length;
+        uint32_t disableMask;
+        // Whether the key refers to a DemangledForm.
+        bool structured;
+
+        bool operator == (const Key& other) const
+        {
+            return disableMask == other.disableMask && structured == other.structured 
+                && length == other.length && ::memcmp(mangled, other.mangled, length) == 0;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator () (const Key& key) const
+        {
+            return static_cast<size_t>(Utils::hashBytes(key.mangled, key.length)) 
+                ^ ((key.disableMask * 2 + key.structured) * 0x9E3779B9U);
+        }
+    };
+
+    struct Entry
+    {
+        std::string mangled;
+        uint32_t disableMask;
+        bool structured;
+        uint32_t generation;
+        int32_t ret;
+        std::string text;
+        uint32_t bufferLength;
+        bool rewritten;
+        DemangledForm form;
+        // The rules without duplicates.
+        RewriteTrace trace;
+        size_t cost;
+
+        Key key() const
+        {
+            const Key key = { mangled.c_str(), mangled.size(), disableMask, structured };
+            return key;
+        }
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    mutable std::mutex m_mutex;
+    EntryList m_entries;
+    std::unordered_map<Key, EntryList::iterator, KeyHash> m_index;
+    std::unordered_map<const Substitution*, std::unordered_set<const Entry*>> m_rewrites;
+    size_t m_memoryLimit;
+    size_t m_memoryUsage;
+    size_t m_evictions;
+public:
+    /**
+     * @brief   Decides whether a rule change may alter a cached name.
+     * @param   mangled The mangled name.
+     * @param   text    The substituted name, or the text of the form.
+     * @param   trace   What rewrote it.
+     */
+    typedef std::function<bool (const char* mangled, const std::string& text, 
+        const RewriteTrace& trace)> ChangePredicate;
+public:
+    /**
+     * @brief   Constructor.
+     * @param   memoryLimit Approximate upper bound for the memory used by entries, in bytes.
+     */
+    explicit ResultCache(size_t memoryLimit);
+public:
+    /**
+     * @brief   Looks up a demangling result.
+     * @param   mangled         The mangled name.
+     * @param   disableMask     The disable mask the demangler was invoked with.
+     * @param   generation      The current rule set generation.
+     * @param   answer          The output buffer receiving the cached name.
+     * @param   answerLength    Length of @c answer buffer.
+     * @param   ret             Receives the original demangler's return value.
+     * @return  @c true on a hit, else @c false.
+     */
+    bool lookup(const char* mangled, uint32_t disableMask, uint32_t generation,
+        char* answer, uint32_t answerLength, int32_t& ret);
+    /**
+     * @brief   Stores a demangling result.
+     * @param   mangled         The mangled name.
+     * @param   disableMask     The disable mask the demangler was invoked with.
+     * @param   generation      The rule set generation the result was produced with.
+     * @param   ret             The original demangler's return value.
+     * @param   text            The substituted name or @c nullptr if demangling failed.
+     * @param   answerLength    Length of the buffer @c text was produced in.
+     * @param   trace           What rewrote the name.
+     */
+    void insert(const char* mangled, uint32_t disableMask, uint32_t generation, int32_t ret,
+        const char* text, uint32_t answerLength, const RewriteTrace& trace);
+    /**
+     * @brief   Looks up a demangled, not yet substituted name rendered from a cached 
+     *          DemangledForm.
+     * @param   mangled         The mangled name.
+     * @param   disableMask     The disable mask the demangler was invoked with.
+     * @param   answer          The output buffer receiving the rendered name.
+     * @param   answerLength    Length of @c answer buffer.
+     * @param   ret             Receives the original demangler's return value.
+     * @return  @c true on a hit, else @c false.
+     */
+    bool lookupVariant(const char* mangled, uint32_t disableMask, char* answer, 
+        uint32_t answerLength, int32_t& ret);
+    /**
+     * @brief   Stores a form serving all disable masks with the same base mask.
+     * @param   mangled         The mangled name.
+     * @param   baseMask        The disable mask the form was demangled with.
+     * @param   ret             The original demangler's return value.
+     * @param   form            The form or @c nullptr if demangling failed.
+     */
+    void insertForm(const char* mangled, uint32_t baseMask, int32_t ret, 
+        const DemangledForm* form);
+    /**
+     * @brief   Moves the entries of one generation to the next, dropping those a rule change
+     *          may affect. Entries of other generations and forms are left alone.
+     * @param   removed     The rules removed by the change, entries they rewrote are dropped.
+     * @param   mayChange   Decides for the other successful demanglings.
+     * @return  The number of entries dropped.
+     */
+    size_t carryOver(uint32_t from, uint32_t to, const std::vector<const Substitution*>& removed,
+        const ChangePredicate& mayChange);
+    void clear();
+    void setMemoryLimit(size_t memoryLimit);
+    size_t memoryLimit() const;
+    size_t memoryUsage() const;
+    /**
+     * @brief   Returns the number of entries evicted for lack of memory so far.
+     */
+    size_t evictions() const;
+protected:
+    /**
+     * @brief   Finds a current entry, dropping it if it is stale. Forms are never stale.
+     */
+    EntryList::iterator find(const Key& key, uint32_t generation);
+    void store(Entry entry);
+    void evict();
+    void erase(EntryList::iterator entry);
+};
+
+// ============================================================================================== //
+
+#endif // RESULTCACHE_HPP
@@ -0,0 +1,220 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RulePersister.hpp"
+
+#include "ImportExport.hpp"
+#include "Settings.hpp"
+#include "Config.hpp"
+
+#include <QStringList>
+#include <cassert>
+#include <ida.hpp>
+#include <kernwin.hpp>
+
+// ============================================================================================== //
+// [RulePersister]                                                                                //
+// ============================================================================================== //
+
+namespace
+{
+    const int kQuietPeriodMs = 500;
+}
+
+bool RulePersister::Entry::operator == (const Entry& other) const
+{
+    return pattern == other.pattern && replacement == other.replacement && mode == other.mode 
+        && guards == other.guards;
+}
+
+RulePersister::RulePersister(SubstitutionManager* manager, const QString& archivePath)
+    : m_manager(manager)
+    , m_archivePath(archivePath)
+    , m_stopping(false)
+    , m_storedKnown(false)
+{
+    assert(manager);
+
+    m_quietTimer.setSingleShot(true);
+    m_quietTimer.setInterval(kQuietPeriodMs);
+    connect(&m_quietTimer, SIGNAL(timeout()), SLOT(flush()));
+    m_worker = std::thread(&RulePersister::work, this);
+}
+
+RulePersister::~RulePersister()
+{
+    if (m_quietTimer.isActive())
+        flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_one();
+    m_worker.join();
+}
+
+void RulePersister::schedule()
+{
+    m_quietTimer.start();
+}
+
+void RulePersister::flush()
+{
+    m_quietTimer.stop();
+
+    // Published rules are immutable, copying the pointers captures the rules as they are.
+    std::unique_ptr<Job> job(new Job);
+    job->rules = m_manager->rules();
+    job->backend = m_manager->backend();
+    job->contentHash = SubstitutionManager::Snapshot(m_manager->ruleSet())->contentHash();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingJob = std::move(job);
+    }
+    m_jobAvailable.notify_one();
+}
+
+void RulePersister::work()
+{
+    for (;;)
+    {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this] { return m_pendingJob || m_stopping; });
+            if (!m_pendingJob)
+                break;
+            job = std::move(m_pendingJob);
+        }
+        save(*job);
+    }
+}
+
+void RulePersister::save(const Job& job)
+{
+    Settings settings;
+    if (!m_storedKnown)
+    {
+        m_stored = readEntries(settings);
+        m_storedKnown = true;
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(job.rules.size());
+    for (auto it = job.rules.cbegin(), end = job.rules.cend(); it != end; ++it)
+        entries.push_back(entryFromRule(**it));
+
+    const auto archiveHash = settings.value(Settings::kRuleArchiveHash, 0).toULongLong();
+    if (entries == m_stored && archiveHash == job.contentHash)
+        return;
+
+    // The archive is only trusted at startup while its hash is recorded, drop it until the
+    // settings and the archive agree again.
+    settings.remove(Settings::kRuleArchiveHash);
+    writeEntries(settings, entries);
+    m_stored = std::move(entries);
+
+    try
+    {
+        ArchiveImporterExporter::writeArchive(m_archivePath, job.rules, job.backend, 
+            job.contentHash);
+        settings.setValue(Settings::kRuleArchiveHash, 
+            static_cast<qulonglong>(job.contentHash));
+    }
+    catch (const ArchiveImporterExporter::Error& e)
+    {
+        msg("[" PLUGIN_NAME "] Cannot save rule archive: %s\n", e.what());
+    }
+    settings.sync();
+}
+
+void RulePersister::writeEntries(QSettings& settings, const std::vector<Entry>& entries) const
+{
+    settings.beginWriteArray(Settings::kSubstitutionGroup, static_cast<int>(entries.size()));
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (i < m_stored.size() && entries[i] == m_stored[i])
+            continue;
+
+        const auto& entry = entries[i];
+        settings.setArrayIndex(static_cast<int>(i));
+        settings.setValue(Settings::kSubstitutionPattern, 
+            QString::fromStdString(entry.pattern));
+        settings.setValue(Settings::kSubstitutionReplacement, 
+            QString::fromStdString(entry.replacement));
+        settings.setValue(Settings::kSubstitutionMode, QString::fromStdString(entry.mode));
+
+        QStringList guards;
+        for (auto it = entry.guards.cbegin(), end = entry.guards.cend(); it != end; ++it)
+            guards << QString::fromStdString(*it);
+        if (guards.isEmpty())
+            settings.remove(Settings::kSubstitutionGuards);
+        else
+            settings.setValue(Settings::kSubstitutionGuards, guards);
+    }
+
+    // An empty key removes the entry's whole group.
+    for (size_t i = entries.size(); i < m_stored.size(); ++i)
+    {
+        settings.setArrayIndex(static_cast<int>(i));
+        settings.remove(QString());
+    }
+    settings.endArray();
+}
+
+std::vector<RulePersister::Entry> RulePersister::readEntries(QSettings& settings)
+{
+    std::vector<Entry> entries;
+    const int size = settings.beginReadArray(Settings::kSubstitutionGroup);
+    entries.reserve(size);
+    for (int i = 0; i < size; ++i)
+    {
+        settings.setArrayIndex(i);
+        Entry entry;
+        entry.pattern = settings.value(Settings::kSubstitutionPattern).toString().toStdString();
+        entry.replacement 
+            = settings.value(Settings::kSubstitutionReplacement).toString().toStdString();
+        entry.mode = settings.value(Settings::kSubstitutionMode).toString().toStdString();
+        const auto guards = settings.value(Settings::kSubstitutionGuards).toStringList();
+        for (auto it = guards.cbegin(), end = guards.cend(); it != end; ++it)
+            entry.guards.push_back(it->toStdString());
+        entries.push_back(std::move(entry));
+    }
+    settings.endArray();
+    return entries;
+}
+
+RulePersister::Entry RulePersister::entryFromRule(const Substitution& rule)
+{
+    Entry entry;
+    entry.pattern = rule.regexpPattern;
+    entry.replacement = rule.replacement;
+    entry.mode = Substitution::modeName(rule.mode);
+    entry.guards = rule.declaredGuards;
+    return entry;
+}
+
+// ============================================================================================== //
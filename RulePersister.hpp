@@ -0,0 +1,127 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RULEPERSISTER_HPP
+#define RULEPERSISTER_HPP
+
+#include "Utils.hpp"
+#include "SubstitutionManager.hpp"
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================================== //
+// [RulePersister]                                                                                //
+// ============================================================================================== //
+
+/**
+ * @brief   Saves the rules of a manager to the settings and the rule archive in the background.
+ *
+ * Changes are collected until the rules were left alone for a short while, then the current
+ * rules are handed to a worker thread, so editing never waits for storage. The worker only 
+ * rewrites the settings entries that differ from what is stored. The archive is replaced 
+ * atomically and only recorded as mirroring the settings once both are written.
+ */
+class RulePersister : public QObject, public Utils::NonCopyable
+{
+    Q_OBJECT
+
+    /**
+     * @brief   A rule as stored in the settings.
+     */
+    struct Entry
+    {
+        std::string pattern;
+        std::string replacement;
+        std::string mode;
+        std::vector<std::string> guards;
+
+        bool operator == (const Entry& other) const;
+    };
+
+    /**
+     * @brief   The rules to save, captured on the UI thread.
+     */
+    struct Job
+    {
+        SubstitutionManager::SubstitutionList rules;
+        RegexBackend::Kind backend;
+        uint64_t contentHash;
+    };
+protected:
+    SubstitutionManager* m_manager;
+    QString m_archivePath;
+    QTimer m_quietTimer;
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    // Only the latest job matters, a newer one replaces a job not started yet.
+    std::unique_ptr<Job> m_pendingJob;
+    bool m_stopping;
+    // Owned by the worker. What the settings hold, read on the first save.
+    std::vector<Entry> m_stored;
+    bool m_storedKnown;
+public:
+    /**
+     * @brief   Constructor.
+     * @param   archivePath The rule archive mirroring the settings, see 
+     *                      ArchiveImporterExporter.
+     */
+    RulePersister(SubstitutionManager* manager, const QString& archivePath);
+    /**
+     * @brief   Destructor, saves pending changes and waits for the worker to finish.
+     */
+    ~RulePersister();
+public slots:
+    /**
+     * @brief   Schedules saving the rules after the quiet period, restarting it if already
+     *          scheduled.
+     */
+    void schedule();
+    /**
+     * @brief   Hands the current rules to the worker right away. Must be called on the UI 
+     *          thread.
+     */
+    void flush();
+protected:
+    void work();
+    void save(const Job& job);
+    /**
+     * @brief   Rewrites the entries differing from the stored ones and removes surplus ones.
+     */
+    void writeEntries(QSettings& settings, const std::vector<Entry>& entries) const;
+    static std::vector<Entry> readEntries(QSettings& settings);
+    static Entry entryFromRule(const Substitution& rule);
+};
+
+// ============================================================================================== //
+
+#endif // RULEPERSISTER_HPP
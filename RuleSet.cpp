@@ -0,0 +1,203 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RuleSet.hpp"
+
+#include "SubstitutionManager.hpp"
+#include "PatternAnalysis.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+// ============================================================================================== //
+// [RuleSet]                                                                                      //
+// ============================================================================================== //
+
+RuleSet::RuleSet(const SubstitutionList& rules, unsigned generation)
+    : m_rules(rules)
+    , m_otherRequirements(rules.size())
+    , m_allGuarded(true)
+    , m_generation(generation)
+    , m_contentHash(Utils::kFnvOffsetBasis)
+{
+    std::map<std::string, uint32_t> literalIds;
+    std::vector<std::string> literals;
+    auto literalId = [&](const std::string& literal) -> uint32_t
+    {
+        auto inserted = literalIds.insert(std::make_pair(literal, 
+            static_cast<uint32_t>(literals.size())));
+        if (inserted.second)
+        {
+            literals.push_back(literal);
+            m_literalRules.emplace_back();
+        }
+        return inserted.first->second;
+    };
+
+    std::vector<std::vector<uint32_t>> ruleLiterals(m_rules.size());
+    for (unsigned i = 0; i < m_rules.size(); ++i)
+    {
+        const auto& required = m_rules[i]->requiredLiterals;
+        if (required.empty())
+        {
+            m_unconditionalRules.push_back(i);
+            continue;
+        }
+
+        const auto selective = PatternAnalysis::mostSelective(required);
+        for (size_t j = 0; j < required.size(); ++j)
+        {
+            std::vector<uint32_t> ids;
+            for (auto it = required[j].cbegin(), end = required[j].cend(); it != end; ++it)
+                ids.push_back(literalId(*it));
+            ruleLiterals[i].insert(ruleLiterals[i].end(), ids.cbegin(), ids.cend());
+
+            if (j == selective)
+            {
+                for (auto it = ids.cbegin(), end = ids.cend(); it != end; ++it)
+                    m_literalRules[*it].push_back(i);
+            }
+            else
+            {
+                std::sort(ids.begin(), ids.end());
+                m_otherRequirements[i].push_back(std::move(ids));
+            }
+        }
+
+        std::sort(ruleLiterals[i].begin(), ruleLiterals[i].end());
+        ruleLiterals[i].erase(std::unique(ruleLiterals[i].begin(), ruleLiterals[i].end()), 
+            ruleLiterals[i].end());
+    }
+
+    m_literals = LiteralMatcher(literals);
+
+    // Each field is hashed with its terminator, so adjacent fields cannot run into another.
+    for (auto it = m_rules.cbegin(), end = m_rules.cend(); it != end; ++it)
+    {
+        const auto& rule = **it;
+        const uint32_t mode = rule.mode;
+        m_contentHash = Utils::fnv1a(&mode, sizeof(mode), m_contentHash);
+        m_contentHash = Utils::fnv1a(rule.regexpPattern.c_str(), 
+            rule.regexpPattern.size() + 1, m_contentHash);
+        m_contentHash = Utils::fnv1a(rule.replacement.c_str(), 
+            rule.replacement.size() + 1, m_contentHash);
+        for (auto guard = rule.declaredGuards.cbegin(), guardsEnd = rule.declaredGuards.cend(); 
+                guard != guardsEnd; ++guard)
+            m_contentHash = Utils::fnv1a(guard->c_str(), guard->size() + 1, m_contentHash);
+        m_contentHash = Utils::fnv1a("", 1, m_contentHash);
+    }
+
+    std::vector<std::string> guards;
+    for (auto it = m_rules.cbegin(), end = m_rules.cend(); it != end; ++it)
+    {
+        const auto& ruleGuards = (*it)->mangledGuards;
+        if (ruleGuards.empty())
+            m_allGuarded = false;
+        guards.insert(guards.end(), ruleGuards.cbegin(), ruleGuards.cend());
+    }
+    if (m_allGuarded)
+    {
+        std::sort(guards.begin(), guards.end());
+        guards.erase(std::unique(guards.begin(), guards.end()), guards.end());
+        m_guards = LiteralMatcher(guards);
+    }
+
+    // Most replacements join captured text and affect every rule, those aren't listed
+    // explicitly. Many rules share literals, so test each literal once per producer.
+    m_dependents.resize(m_rules.size());
+    m_affectsAll.resize(m_rules.size());
+    std::vector<bool> produced(literals.size());
+    for (unsigned producer = 0; producer < m_rules.size(); ++producer)
+    {
+        const auto& replacement = m_rules[producer]->replacementTemplate;
+        m_affectsAll[producer] = replacement.joinsText();
+        if (m_affectsAll[producer])
+            continue;
+
+        for (uint32_t literal = 0; literal < literals.size(); ++literal)
+            produced[literal] = replacement.mayProduce(literals[literal]);
+
+        auto& dependents = m_dependents[producer];
+        dependents = m_unconditionalRules;
+        for (unsigned rule = 0; rule < m_rules.size(); ++rule)
+        {
+            const auto& ids = ruleLiterals[rule];
+            if (rule != producer && std::any_of(ids.cbegin(), ids.cend(), [&](uint32_t id)
+                {
+                    return produced[id];
+                }))
+                dependents.push_back(rule);
+        }
+
+        std::sort(dependents.begin(), dependents.end());
+        dependents.erase(std::remove(dependents.begin(), dependents.end(), producer), 
+            dependents.end());
+    }
+}
+
+void RuleSet::findCandidates(const char* begin, const char* end, 
+    std::vector<unsigned>& candidates, std::vector<uint32_t>& hitLiterals) const
+{
+    // Collect each hit literal once, names tend to repeat them (think "std::").
+    hitLiterals.clear();
+    m_literals.scan(begin, end, [&](uint32_t literalId)
+    {
+        hitLiterals.push_back(literalId);
+    });
+    std::sort(hitLiterals.begin(), hitLiterals.end());
+    hitLiterals.erase(std::unique(hitLiterals.begin(), hitLiterals.end()), hitLiterals.end());
+
+    candidates.assign(m_unconditionalRules.cbegin(), m_unconditionalRules.cend());
+    for (auto it = hitLiterals.cbegin(), hitEnd = hitLiterals.cend(); it != hitEnd; ++it)
+    {
+        const auto& rules = m_literalRules[*it];
+        candidates.insert(candidates.end(), rules.cbegin(), rules.cend());
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // Drop the rules missing any of their other required literals.
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](unsigned rule)
+    {
+        const auto& requirements = m_otherRequirements[rule];
+        return std::any_of(requirements.cbegin(), requirements.cend(), 
+            [&](const std::vector<uint32_t>& ids)
+        {
+            return std::none_of(ids.cbegin(), ids.cend(), [&](uint32_t id)
+            {
+                return std::binary_search(hitLiterals.cbegin(), hitLiterals.cend(), id);
+            });
+        });
+    }), candidates.end());
+}
+
+bool RuleSet::mayApplyToMangled(const char* mangled) const
+{
+    return !m_allGuarded || mangled[0] != '?' 
+        || m_guards.containsAny(mangled, mangled + ::strlen(mangled));
+}
+
+// ============================================================================================== //
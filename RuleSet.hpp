@@ -0,0 +1,150 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RULESET_HPP
+#define RULESET_HPP
+
+#include "Utils.hpp"
+#include "LiteralMatcher.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Substitution;
+
+// ============================================================================================== //
+// [RewriteTrace]                                                                                 //
+// ============================================================================================== //
+
+/**
+ * @brief   Records what rewrote a name, see SubstitutionManager::applyToString.
+ */
+struct RewriteTrace
+{
+    /**
+     * @brief   The rules that rewrote the name, in the order they did so, possibly repeated.
+     */
+    std::vector<const Substitution*> rules;
+    /**
+     * @brief   The name before each elision of defaulted template arguments. Rules get to see
+     *          these as well as the result.
+     */
+    std::vector<std::string> elidedFrom;
+    /**
+     * @brief   Whether the rewrite budget ran out before the name stopped changing.
+     */
+    bool stoppedEarly;
+
+    RewriteTrace() : stoppedEarly(false) {}
+
+    void clear()
+    {
+        rules.clear();
+        elidedFrom.clear();
+        stoppedEarly = false;
+    }
+};
+
+// ============================================================================================== //
+// [RuleSet]                                                                                      //
+// ============================================================================================== //
+
+/**
+ * @brief   Immutable, compiled form of a list of substitution rules.
+ *
+ * Every rule is indexed by the literals its pattern requires (see 
+ * PatternAnalysis::requiredLiterals). A single scan over a name with one automaton for the 
+ * literals of all rules then yields the rules that can possibly match it, in list order: 
+ * those for which every set of required alternatives has a literal occurring in the name.
+ * The rules referenced by a rule set must not be modified, it may be in use by other threads.
+ *
+ * Additionally, the rule set knows which rules may produce text another rule consumes: rule B
+ * depends on rule A if B requires no literals or A's replacement may create an occurrence of
+ * one of them. Only the dependents of a rule need to be reconsidered after it rewrote a name.
+ *
+ * Finally, the guards of all rules on mangled names are combined into another automaton,
+ * so a single scan over a short MSVC mangled name can rule out every rule at once.
+ */
+class RuleSet : public Utils::NonCopyable
+{
+public:
+    typedef std::vector<std::shared_ptr<Substitution>> SubstitutionList;
+protected:
+    SubstitutionList m_rules;
+    LiteralMatcher m_literals;
+    // Rules are listed under the literals of their most selective alternatives only.
+    std::vector<std::vector<unsigned>> m_literalRules;
+    // The remaining alternatives of each rule as ascending literal IDs, checked on a hit.
+    std::vector<std::vector<std::vector<uint32_t>>> m_otherRequirements;
+    std::vector<unsigned> m_unconditionalRules;
+    std::vector<std::vector<unsigned>> m_dependents;
+    std::vector<bool> m_affectsAll;
+    LiteralMatcher m_guards;
+    bool m_allGuarded;
+    unsigned m_generation;
+    uint64_t m_contentHash;
+public:
+    RuleSet(const SubstitutionList& rules, unsigned generation);
+public:
+    const SubstitutionList& rules() const { return m_rules; }
+    /**
+     * @brief   Returns the generation of the manager this rule set was built for.
+     */
+    unsigned generation() const { return m_generation; }
+    /**
+     * @brief   Returns a hash of the rules' definitions. Unlike the generation, it is equal
+     *          for equal rules across sessions.
+     */
+    uint64_t contentHash() const { return m_contentHash; }
+    /**
+     * @brief   Determines the rules that may match a string.
+     * @param   begin       Start of the string.
+     * @param   end         End of the string.
+     * @param   candidates  Receives the ascending indices of the candidate rules.
+     * @param   literalHits Scratch buffer.
+     */
+    void findCandidates(const char* begin, const char* end, 
+        std::vector<unsigned>& candidates, std::vector<uint32_t>& literalHits) const;
+    /**
+     * @brief   Determines whether every other rule depends on a rule.
+     */
+    bool affectsAll(unsigned rule) const { return m_affectsAll[rule]; }
+    /**
+     * @brief   Returns the ascending indices of the rules depending on a rule, excluding 
+     *          the rule itself. Empty if affectsAll() is @c true.
+     */
+    const std::vector<unsigned>& dependents(unsigned rule) const { return m_dependents[rule]; }
+    /**
+     * @brief   Determines whether any rule may apply to the demangling of a name.
+     * @param   mangled The mangled name, null-terminated. Only MSVC names ('?') are 
+     *                  understood, the result is always @c true for others.
+     * @return  @c false if no rule's guard occurs in the mangled name.
+     */
+    bool mayApplyToMangled(const char* mangled) const;
+};
+
+// ============================================================================================== //
+
+#endif // RULESET_HPP
@@ -0,0 +1,76 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ScratchArena.hpp"
+
+// ============================================================================================== //
+// [ScratchArena]                                                                                 //
+// ============================================================================================== //
+
+std::atomic<uint64_t> ScratchArena::m_growthCount(0);
+
+ScratchArena::ScratchArena()
+    : m_groupsHighWater(0)
+{
+    
+}
+
+ScratchArena& ScratchArena::local()
+{
+    static thread_local ScratchArena arena;
+    return arena;
+}
+
+size_t ScratchArena::capacity() const
+{
+    return m_text.capacity() + m_unelided.capacity() + m_candidates.capacity() 
+        + m_worklist.capacity() + m_literalHits.capacity();
+}
+
+// ============================================================================================== //
+// [ScratchArena::Scope]                                                                          //
+// ============================================================================================== //
+
+ScratchArena::Scope::Scope(ScratchArena& arena)
+    : m_arena(arena)
+    , m_capacity(arena.capacity())
+{
+    
+}
+
+ScratchArena::Scope::~Scope()
+{
+    // Match results only reallocate when exceeding the largest group count seen so far.
+    bool grown = m_arena.capacity() != m_capacity;
+    if (m_arena.m_stdGroups.size() > m_arena.m_groupsHighWater)
+    {
+        m_arena.m_groupsHighWater = m_arena.m_stdGroups.size();
+        grown = true;
+    }
+
+    if (grown)
+        ++m_growthCount;
+}
+
+// ============================================================================================== //
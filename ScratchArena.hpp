@@ -0,0 +1,99 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SCRATCHARENA_HPP
+#define SCRATCHARENA_HPP
+
+#include "Utils.hpp"
+#include "RegexBackend.hpp"
+
+#include <regex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================================== //
+// [ScratchArena]                                                                                 //
+// ============================================================================================== //
+
+/**
+ * @brief   Per-thread scratch memory for the substitution hot path.
+ *
+ * The buffers keep their capacity between calls, so once they have grown to the size of the
+ * largest name seen, the substitution code itself performs no further heap allocations. The
+ * regex engines still allocate internally: std::regex on every match, RE2 on some.
+ *
+ * Each time an arena buffer had to grow while a @c Scope was active, the process-wide growth
+ * counter is incremented. It tracks the arena only; allocations elsewhere, such as those of
+ * the regex engines, are not counted. retypedef_bench counts all heap allocations.
+ */
+class ScratchArena : public Utils::NonCopyable
+{
+    MatchGroups m_groups;
+    std::cmatch m_stdGroups;
+    std::string m_text;
+    std::string m_unelided;
+    std::vector<unsigned> m_candidates;
+    std::vector<unsigned> m_worklist;
+    std::vector<uint32_t> m_literalHits;
+    size_t m_groupsHighWater;
+    static std::atomic<uint64_t> m_growthCount;
+public:
+    /**
+     * @brief   Records buffer growth that happened during its lifetime.
+     */
+    class Scope : public Utils::NonCopyable
+    {
+        ScratchArena& m_arena;
+        size_t m_capacity;
+    public:
+        explicit Scope(ScratchArena& arena);
+        ~Scope();
+    };
+public:
+    /**
+     * @brief   Returns the arena of the calling thread.
+     */
+    static ScratchArena& local();
+    /**
+     * @brief   Returns the number of scopes in which any arena buffer had to grow.
+     */
+    static uint64_t growthCount() { return m_growthCount; }
+public:
+    MatchGroups& groups() { return m_groups; }
+    std::cmatch& stdGroups() { return m_stdGroups; }
+    std::string& text() { return m_text; }
+    std::string& unelided() { return m_unelided; }
+    std::vector<unsigned>& candidates() { return m_candidates; }
+    std::vector<unsigned>& worklist() { return m_worklist; }
+    std::vector<uint32_t>& literalHits() { return m_literalHits; }
+protected:
+    ScratchArena();
+    size_t capacity() const;
+};
+
+// ============================================================================================== //
+
+#endif // SCRATCHARENA_HPP
@@ -33,7 +33,22 @@
 const QString Settings::kSubstitutionGroup = "substitutions";
 const QString Settings::kSubstitutionPattern = "pattern";
 const QString Settings::kSubstitutionReplacement = "repl";
+const QString Settings::kSubstitutionMode = "mode";
+const QString Settings::kSubstitutionGuards = "guards";
 const QString Settings::kFirstStart = "firstStart";
+const QString Settings::kResultCacheMemoryLimit = "resultCacheMemoryLimit";
+const QString Settings::kRegexBackend = "regexBackend";
+const QString Settings::kRewriteIterationBudget = "rewriteIterationBudget";
+const QString Settings::kRewriteTimeBudgetMs = "rewriteTimeBudgetMs";
+const QString Settings::kElideDefaultTemplateArgs = "elideDefaultTemplateArgs";
+const QString Settings::kDeriveDemangleVariants = "deriveDemangleVariants";
+const QString Settings::kPrewarmOnLoad = "prewarmOnLoad";
+const QString Settings::kPersistentCache = "persistentCache";
+const QString Settings::kSharedCache = "sharedCache";
+const QString Settings::kSharedCacheSize = "sharedCacheSize";
+const QString Settings::kRuleArchiveHash = "ruleArchiveHash";
+const QString Settings::kLazyCompilation = "lazyCompilation";
+const QString Settings::kStatisticsSampleRate = "statisticsSampleRate";
 
 Settings::Settings()
     : QSettings("athre0z", PLUGIN_NAME)
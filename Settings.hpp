@@ -44,7 +44,22 @@ public:
     static const QString kSubstitutionGroup;
     static const QString kSubstitutionPattern;
     static const QString kSubstitutionReplacement;
+    static const QString kSubstitutionMode;
+    static const QString kSubstitutionGuards;
     static const QString kFirstStart;
+    static const QString kResultCacheMemoryLimit;
+    static const QString kRegexBackend;
+    static const QString kRewriteIterationBudget;
+    static const QString kRewriteTimeBudgetMs;
+    static const QString kElideDefaultTemplateArgs;
+    static const QString kDeriveDemangleVariants;
+    static const QString kPrewarmOnLoad;
+    static const QString kPersistentCache;
+    static const QString kSharedCache;
+    static const QString kSharedCacheSize;
+    static const QString kRuleArchiveHash;
+    static const QString kLazyCompilation;
+    static const QString kStatisticsSampleRate;
 };
 
 // ============================================================================================== //
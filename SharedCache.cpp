@@ -0,0 +1,203 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SharedCache.hpp"
+
+#include "Config.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+// ============================================================================================== //
+// [SharedCache]                                                                                  //
+// ============================================================================================== //
+
+namespace
+{
+    const uint32_t kMagic = 0x43445452; // "RTDC"
+    const uint32_t kFormatVersion = 1;
+    const uint32_t kNoText = 0xFFFFFFFF;
+}
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "slots are shared between processes");
+
+SharedCache::SharedCache()
+    : m_insertions(0)
+{
+
+}
+
+void SharedCache::attach(uint64_t tag, size_t size)
+{
+    detach();
+
+    std::unique_ptr<Segment> segment(new Segment(segmentKey(tag)));
+    segment->tag = tag;
+    auto& memory = segment->memory;
+    if (!memory.create(static_cast<int>(size)))
+    {
+        if (memory.error() != QSharedMemory::AlreadyExists || !memory.attach())
+            throw Error(memory.errorString().toStdString().c_str());
+    }
+
+    if (static_cast<size_t>(memory.size()) < sizeof(Header) + kWays * kSlotSize)
+        throw Error("shared cache segment too small");
+
+    // Whoever gets the lock first writes the header, the values are the same for everyone.
+    const uint64_t slotCount = (memory.size() - sizeof(Header)) / kSlotSize / kWays * kWays;
+    auto header = static_cast<Header*>(memory.data());
+    memory.lock();
+    if (!header->magic)
+    {
+        header->formatVersion = kFormatVersion;
+        header->slotSize = kSlotSize;
+        header->slotCount = static_cast<uint32_t>(slotCount);
+        header->magic = kMagic;
+    }
+    const bool valid = header->magic == kMagic && header->formatVersion == kFormatVersion
+        && header->slotSize == kSlotSize && header->slotCount <= slotCount 
+        && header->slotCount >= kWays;
+    memory.unlock();
+    if (!valid)
+        throw Error("incompatible shared cache segment");
+
+    segment->bucketCount = header->slotCount / kWays;
+    segment->table = reinterpret_cast<Slot*>(header + 1);
+    m_segment.update(std::move(segment));
+}
+
+void SharedCache::detach()
+{
+    m_segment.update(nullptr);
+}
+
+bool SharedCache::lookup(const char* mangled, uint32_t disableMask, uint64_t tag, 
+    char* answer, uint32_t answerLength, int32_t& ret) const
+{
+    Utils::RcuPointer<Segment>::ReadGuard segment(m_segment);
+    if (!segment.get() || segment->tag != tag)
+        return false;
+
+    const size_t length = std::strlen(mangled);
+    const auto fullHash = hash(mangled, length, disableMask);
+    const auto slotHash = static_cast<uint32_t>(fullHash);
+    auto bucket = segment->table + (slotHash % segment->bucketCount) * kWays;
+    for (uint32_t way = 0; way < kWays; ++way)
+    {
+        auto& slot = bucket[way];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        if (!sequence || (sequence & 1) || slot.hash != slotHash 
+                || slot.disableMask != disableMask || slot.mangledLength != length)
+            continue;
+
+        // The fields may be torn by a concurrent writer until the sequence is checked again,
+        // lengths are validated before they are used.
+        const uint32_t textLength = slot.textLength;
+        const bool hasText = textLength != kNoText;
+        if (length > sizeof(slot.data) 
+                || (hasText && (textLength >= sizeof(slot.data) - length 
+                    || textLength >= answerLength)))
+            continue;
+        if (std::memcmp(slot.data, mangled, length) != 0)
+            continue;
+
+        const int32_t result = slot.ret;
+        if (hasText)
+        {
+            std::memcpy(answer, slot.data + length, textLength);
+            answer[textLength] = '\0';
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            return false;
+        ret = result;
+        return true;
+    }
+    return false;
+}
+
+void SharedCache::insert(const char* mangled, uint32_t disableMask, uint64_t tag, 
+    int32_t ret, const char* text)
+{
+    Utils::RcuPointer<Segment>::ReadGuard segment(m_segment);
+    if (!segment.get() || segment->tag != tag)
+        return;
+
+    const size_t length = std::strlen(mangled);
+    const size_t textLength = text ? std::strlen(text) : 0;
+    if (length + textLength + 1 > sizeof(Slot::data))
+        return;
+
+    const auto fullHash = hash(mangled, length, disableMask);
+    const auto slotHash = static_cast<uint32_t>(fullHash);
+    auto bucket = segment->table + (slotHash % segment->bucketCount) * kWays;
+
+    // Prefer a free slot, otherwise evict a way chosen round-robin. Another process may have
+    // stored the result meanwhile, a slot with the same hash and mask is taken as that.
+    Slot* victim = nullptr;
+    for (uint32_t way = 0; way < kWays; ++way)
+    {
+        auto& slot = bucket[way];
+        if (!slot.sequence.load(std::memory_order_relaxed))
+        {
+            if (!victim)
+                victim = &slot;
+        }
+        else if (slot.hash == slotHash && slot.disableMask == disableMask)
+            return;
+    }
+    if (!victim)
+        victim = &bucket[m_insertions++ % kWays];
+
+    auto sequence = victim->sequence.load(std::memory_order_relaxed);
+    if ((sequence & 1) || !victim->sequence.compare_exchange_strong(sequence, sequence + 1, 
+            std::memory_order_acq_rel))
+        return;
+
+    victim->hash = slotHash;
+    victim->disableMask = disableMask;
+    victim->ret = ret;
+    victim->mangledLength = static_cast<uint32_t>(length);
+    victim->textLength = text ? static_cast<uint32_t>(textLength) : kNoText;
+    std::memcpy(victim->data, mangled, length);
+    if (text)
+        std::memcpy(victim->data + length, text, textLength + 1);
+    victim->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+QString SharedCache::segmentKey(uint64_t tag)
+{
+    char key[64];
+    ::sprintf(key, PLUGIN_NAME "-%08X-%u-%016llX", PLUGIN_VERSION, kFormatVersion, 
+        static_cast<unsigned long long>(tag));
+    return QString(key);
+}
+
+uint64_t SharedCache::hash(const char* mangled, size_t length, uint32_t disableMask)
+{
+    return Utils::fnv1a(&disableMask, sizeof(disableMask), Utils::fnv1a(mangled, length));
+}
+
+// ============================================================================================== //
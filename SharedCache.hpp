@@ -0,0 +1,130 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SHAREDCACHE_HPP
+#define SHAREDCACHE_HPP
+
+#include "Utils.hpp"
+
+#include <QSharedMemory>
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+// ============================================================================================== //
+// [SharedCache]                                                                                  //
+// ============================================================================================== //
+
+/**
+ * @brief   Demangler results shared between processes through a named shared memory segment.
+ *
+ * The segment is named after the tag of the rules the results are produced with, so 
+ * instances with equal rules share one segment. It holds a set associative table of fixed
+ * size slots; results not fitting a slot aren't shared.
+ *
+ * Every slot is guarded by a sequence number, odd while the slot is being written. Readers
+ * take no lock and never retry: a sequence number that is odd or changed while copying the
+ * slot makes the lookup a miss. Writers claim a slot by advancing its sequence number to odd
+ * with a compare-and-swap and skip the insert if that fails.
+ */
+class SharedCache : public Utils::NonCopyable
+{
+public:
+    class Error : public std::runtime_error
+        { public: explicit Error(const char *error) : runtime_error(error) {} };
+
+    static const uint32_t kSlotSize = 512;
+    static const uint32_t kWays = 4;
+protected:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t formatVersion;
+        uint32_t slotCount;
+        uint32_t slotSize;
+    };
+
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;
+        uint32_t hash;
+        uint32_t disableMask;
+        int32_t ret;
+        uint32_t mangledLength;
+        uint32_t textLength;
+        // The mangled name followed by the NUL terminated text, if demangling succeeded.
+        char data[kSlotSize - 6 * sizeof(uint32_t)];
+    };
+
+    struct Segment : public Utils::NonCopyable
+    {
+        QSharedMemory memory;
+        uint64_t tag;
+        Slot* table;
+        uint32_t bucketCount;
+
+        explicit Segment(const QString& key) 
+            : memory(key), tag(0), table(nullptr), bucketCount(0) {}
+    };
+
+    Utils::RcuPointer<Segment> m_segment;
+    std::atomic<uint32_t> m_insertions;
+public:
+    SharedCache();
+public:
+    /**
+     * @brief   Attaches to the segment for a tag, creating it if no other process did yet.
+     * @param   tag     Identifies the rules results are produced with.
+     * @param   size    Size of the segment in bytes, if it is created.
+     * @throws  Error   If the segment can neither be created nor attached. The cache is 
+     *                  detached then.
+     */
+    void attach(uint64_t tag, size_t size);
+    void detach();
+    /**
+     * @brief   Looks up a result. @c answer may be modified on a miss.
+     * @param   answerLength    Length of @c answer buffer, a result not fitting is a miss.
+     * @return  @c true on a hit, else @c false.
+     */
+    bool lookup(const char* mangled, uint32_t disableMask, uint64_t tag, 
+        char* answer, uint32_t answerLength, int32_t& ret) const;
+    /**
+     * @brief   Stores a result, unless it doesn't fit a slot or the slot is being written.
+     * @param   text    The substituted name or @c nullptr if demangling failed. Must not be
+     *                  truncated.
+     */
+    void insert(const char* mangled, uint32_t disableMask, uint64_t tag, int32_t ret, 
+        const char* text);
+    /**
+     * @brief   Returns the name of the segment for a tag.
+     */
+    static QString segmentKey(uint64_t tag);
+protected:
+    static uint64_t hash(const char* mangled, size_t length, uint32_t disableMask);
+};
+
+// ============================================================================================== //
+
+#endif // SHAREDCACHE_HPP
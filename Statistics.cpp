@@ -0,0 +1,372 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Statistics.hpp"
+
+#include "SubstitutionManager.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+
+// ============================================================================================== //
+// [StatisticsSampler]                                                                            //
+// ============================================================================================== //
+
+std::atomic<unsigned> StatisticsSampler::m_rate(StatisticsSampler::kDefaultRate);
+
+// ============================================================================================== //
+// [TimedCounter]                                                                                 //
+// ============================================================================================== //
+
+uint64_t TimedCounter::estimatedNs() const
+{
+    const auto samples = this->samples();
+    if (!samples)
+        return 0;
+    return static_cast<uint64_t>(static_cast<double>(m_sampledNs.load(
+        std::memory_order_relaxed)) / samples * std::max(count(), samples));
+}
+
+// ============================================================================================== //
+// [LatencyHistogram]                                                                             //
+// ============================================================================================== //
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (unsigned i = 0; i < kBucketCount; ++i)
+        m_counts[i] = 0;
+}
+
+void LatencyHistogram::record(uint64_t ns)
+{
+    const uint64_t kSubBuckets = 1 << kSubBucketBits;
+    unsigned bucket;
+    if (ns < kSubBuckets)
+    {
+        bucket = static_cast<unsigned>(ns);
+    }
+    else
+    {
+        // The highest bit selects the power of two, the bits below it the bucket within.
+        unsigned highest = kSubBucketBits;
+        while (highest < 63 && (ns >> (highest + 1)))
+            ++highest;
+        const auto shift = highest - kSubBucketBits;
+        bucket = ((highest - kSubBucketBits + 1) << kSubBucketBits) 
+            + static_cast<unsigned>((ns >> shift) & (kSubBuckets - 1));
+    }
+    m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double percent) const
+{
+    uint64_t counts[kBucketCount];
+    uint64_t total = 0;
+    for (unsigned i = 0; i < kBucketCount; ++i)
+        total += counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    if (!total)
+        return 0;
+
+    const auto rank = static_cast<uint64_t>(total * percent / 100.0 + 0.5);
+    uint64_t seen = 0;
+    unsigned bucket = 0;
+    for (; bucket < kBucketCount - 1; ++bucket)
+    {
+        seen += counts[bucket];
+        if (seen >= std::max<uint64_t>(rank, 1))
+            break;
+    }
+
+    const uint64_t kSubBuckets = 1 << kSubBucketBits;
+    if (bucket < kSubBuckets)
+        return bucket + 1;
+    const auto shift = (bucket >> kSubBucketBits) - 1;
+    return (kSubBuckets + (bucket & (kSubBuckets - 1)) + 1) << shift;
+}
+
+// ============================================================================================== //
+// [RuleStats]                                                                                    //
+// ============================================================================================== //
+
+RuleStats::RuleStats(uint64_t namesInspected)
+    : m_namesBefore(namesInspected)
+    , m_selected(0)
+    , m_matches(0)
+    , m_rewrites(0)
+    , m_histogram(nullptr)
+{
+
+}
+
+RuleStats::~RuleStats()
+{
+    delete m_histogram.load();
+}
+
+void RuleStats::countEvaluation(unsigned matches, unsigned rewrites, uint64_t ns)
+{
+    m_evaluations.add();
+    if (matches)
+        m_matches.fetch_add(matches, std::memory_order_relaxed);
+    if (rewrites)
+        m_rewrites.fetch_add(rewrites, std::memory_order_relaxed);
+    if (!ns)
+        return;
+
+    m_evaluations.addSample(ns);
+    auto histogram = m_histogram.load(std::memory_order_acquire);
+    if (!histogram)
+    {
+        // Another thread may have been faster.
+        std::unique_ptr<LatencyHistogram> created(new LatencyHistogram);
+        if (m_histogram.compare_exchange_strong(histogram, created.get()))
+            histogram = created.release();
+    }
+    histogram->record(ns);
+}
+
+RuleStats::Snapshot RuleStats::snapshot(uint64_t namesInspected) const
+{
+    Snapshot snapshot;
+    snapshot.evaluations = m_evaluations.count();
+    const auto names = namesInspected - m_namesBefore;
+    const auto selected = m_selected.load(std::memory_order_relaxed);
+    snapshot.prefilterRejections = names > selected ? names - selected : 0;
+    snapshot.matches = m_matches.load(std::memory_order_relaxed);
+    snapshot.rewrites = m_rewrites.load(std::memory_order_relaxed);
+    snapshot.samples = m_evaluations.samples();
+    snapshot.estimatedNs = m_evaluations.estimatedNs();
+    const auto histogram = m_histogram.load(std::memory_order_acquire);
+    snapshot.p99Ns = histogram ? histogram->percentile(99.0) : 0;
+    return snapshot;
+}
+
+// ============================================================================================== //
+// [StatisticsExporter]                                                                           //
+// ============================================================================================== //
+
+namespace
+{
+    /**
+     * @brief   Escapes a Prometheus label value.
+     */
+    void appendLabelValue(std::string& out, const std::string& value)
+    {
+        out += '"';
+        for (auto it = value.cbegin(), end = value.cend(); it != end; ++it)
+        {
+            if (*it == '\\' || *it == '"')
+                out += '\\';
+            if (*it == '\n')
+                out += "\\n";
+            else
+                out += *it;
+        }
+        out += '"';
+    }
+
+    void appendNumber(std::string& out, uint64_t value)
+    {
+        char buffer[24];
+        std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value));
+        out += buffer;
+    }
+
+    void appendSeconds(std::string& out, uint64_t ns)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9f", ns / 1e9);
+        out += buffer;
+    }
+
+    void writeFile(const QString& path, const std::string& data)
+    {
+        if (!Utils::writeFileAtomically(path, data.data(), data.size()))
+            throw StatisticsExporter::Error("cannot write statistics file");
+    }
+}
+
+StatisticsExporter::StatisticsExporter(const SubstitutionManager* manager, 
+        const HookStats* hookStats)
+    : m_manager(manager)
+    , m_hookStats(hookStats)
+{
+    assert(manager);
+}
+
+void StatisticsExporter::exportJson(const QString& path) const
+{
+    std::string out = "{\n  \"sampleRate\": ";
+    appendNumber(out, StatisticsSampler::rate());
+    out += ",\n  \"namesInspected\": ";
+    const auto namesInspected = m_manager->namesInspected();
+    appendNumber(out, namesInspected);
+
+    if (m_hookStats)
+    {
+        const std::pair<const char*, const TimedCounter*> counters[] = 
+        {
+            std::make_pair("calls", &m_hookStats->calls),
+            std::make_pair("demangler", &m_hookStats->demangler),
+            std::make_pair("substitution", &m_hookStats->substitution),
+        };
+        out += ",\n  \"hook\": {";
+        for (size_t i = 0; i < sizeof(counters) / sizeof(*counters); ++i)
+        {
+            out += i ? ", \"" : "\"";
+            out += counters[i].first;
+            out += "\": {\"count\": ";
+            appendNumber(out, counters[i].second->count());
+            out += ", \"estimatedNs\": ";
+            appendNumber(out, counters[i].second->estimatedNs());
+            out += "}";
+        }
+        out += "}";
+    }
+
+    out += ",\n  \"rules\": [";
+    const auto& rules = m_manager->rules();
+    for (auto it = rules.cbegin(), end = rules.cend(); it != end; ++it)
+    {
+        const auto& rule = **it;
+        const auto stats = rule.stats->snapshot(namesInspected);
+        out += it == rules.cbegin() ? "\n    {\"pattern\": " : ",\n    {\"pattern\": ";
+        Utils::appendJsonString(out, rule.regexpPattern);
+        out += ", \"mode\": ";
+        Utils::appendJsonString(out, Substitution::modeName(rule.mode));
+        out += ", \"evaluations\": ";
+        appendNumber(out, stats.evaluations);
+        out += ", \"prefilterRejections\": ";
+        appendNumber(out, stats.prefilterRejections);
+        out += ", \"matches\": ";
+        appendNumber(out, stats.matches);
+        out += ", \"rewrites\": ";
+        appendNumber(out, stats.rewrites);
+        out += ", \"samples\": ";
+        appendNumber(out, stats.samples);
+        out += ", \"estimatedNs\": ";
+        appendNumber(out, stats.estimatedNs);
+        out += ", \"p99Ns\": ";
+        appendNumber(out, stats.p99Ns);
+        out += "}";
+    }
+    out += "\n  ]\n}\n";
+    writeFile(path, out);
+}
+
+void StatisticsExporter::exportPrometheus(const QString& path) const
+{
+    std::string out;
+    auto header = [&](const char* name, const char* type, const char* help)
+    {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    };
+
+    if (m_hookStats)
+    {
+        header("retypedef_hook_calls_total", "counter", 
+            "Calls of the demangler hook, including cache hits.");
+        out += "retypedef_hook_calls_total ";
+        appendNumber(out, m_hookStats->calls.count());
+        out += '\n';
+        header("retypedef_hook_seconds_total", "counter", 
+            "Time spent in the demangler hook, estimated from samples.");
+        out += "retypedef_hook_seconds_total{part=\"total\"} ";
+        appendSeconds(out, m_hookStats->calls.estimatedNs());
+        out += "\nretypedef_hook_seconds_total{part=\"demangler\"} ";
+        appendSeconds(out, m_hookStats->demangler.estimatedNs());
+        out += "\nretypedef_hook_seconds_total{part=\"substitution\"} ";
+        appendSeconds(out, m_hookStats->substitution.estimatedNs());
+        out += '\n';
+    }
+
+    // One metric family after another, each listing all rules.
+    struct Family
+    {
+        const char* name;
+        const char* type;
+        const char* help;
+        uint64_t RuleStats::Snapshot::* value;
+        bool seconds;
+    };
+    const Family families[] = 
+    {
+        { "retypedef_rule_evaluations_total", "counter", 
+            "Applications of the rule to a name.", &RuleStats::Snapshot::evaluations, false },
+        { "retypedef_rule_prefilter_rejections_total", "counter", 
+            "Names the prefilter kept the rule away from.", 
+            &RuleStats::Snapshot::prefilterRejections, false },
+        { "retypedef_rule_matches_total", "counter", 
+            "Matches of the rule's pattern.", &RuleStats::Snapshot::matches, false },
+        { "retypedef_rule_rewrites_total", "counter", 
+            "Rewrites by the rule.", &RuleStats::Snapshot::rewrites, false },
+        { "retypedef_rule_seconds_total", "counter", 
+            "Time spent applying the rule, estimated from samples.", 
+            &RuleStats::Snapshot::estimatedNs, true },
+        { "retypedef_rule_p99_seconds", "gauge", 
+            "99th percentile of the time to apply the rule, from samples.", 
+            &RuleStats::Snapshot::p99Ns, true },
+    };
+
+    const auto namesInspected = m_manager->namesInspected();
+    const auto& rules = m_manager->rules();
+    std::vector<RuleStats::Snapshot> snapshots;
+    snapshots.reserve(rules.size());
+    for (auto it = rules.cbegin(), end = rules.cend(); it != end; ++it)
+        snapshots.push_back((*it)->stats->snapshot(namesInspected));
+
+    for (size_t i = 0; i < sizeof(families) / sizeof(*families); ++i)
+    {
+        const auto& family = families[i];
+        header(family.name, family.type, family.help);
+        for (size_t rule = 0; rule < rules.size(); ++rule)
+        {
+            out += family.name;
+            out += "{rule=\"";
+            appendNumber(out, rule);
+            out += "\",pattern=";
+            appendLabelValue(out, rules[rule]->regexpPattern);
+            out += "} ";
+            const auto value = snapshots[rule].*family.value;
+            if (family.seconds)
+                appendSeconds(out, value);
+            else
+                appendNumber(out, value);
+            out += '\n';
+        }
+    }
+    writeFile(path, out);
+}
+
+// ============================================================================================== //
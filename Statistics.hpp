@@ -0,0 +1,276 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include "Utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <QString>
+
+class SubstitutionManager;
+
+// ============================================================================================== //
+// [StatisticsSampler]                                                                            //
+// ============================================================================================== //
+
+/**
+ * @brief   Decides which events are timed. Reading the clock costs about as much as a cheap
+ *          rule evaluation, so by default only one in @c kDefaultRate events is timed and the
+ *          totals are extrapolated from the samples.
+ */
+class StatisticsSampler
+{
+    static std::atomic<unsigned> m_rate;
+public:
+    static const unsigned kDefaultRate = 64;
+
+    /**
+     * @brief   Times one in @c rate events, none if @c rate is zero.
+     */
+    static void setRate(unsigned rate) { m_rate = rate; }
+    static unsigned rate() { return m_rate; }
+    /**
+     * @brief   Returns whether the calling thread should time its next event.
+     *
+     * The gaps between samples are random with a mean of the rate. A hook call produces a
+     * fixed sequence of events, a fixed stride dividing its length would time the same kind
+     * of event every time and never the others.
+     */
+    static bool sample()
+    {
+        static thread_local unsigned countdown = 0;
+        const unsigned rate = m_rate.load(std::memory_order_relaxed);
+        if (!rate || countdown-- != 0)
+            return false;
+        countdown = random() % (2 * rate - 1);
+        return true;
+    }
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+private:
+    /**
+     * @brief   Per-thread xorshift generator, seeded from the thread's own storage address.
+     */
+    static uint32_t random()
+    {
+        static thread_local uint32_t state = 0;
+        if (!state)
+            state = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&state) >> 4) | 1;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+// ============================================================================================== //
+// [TimedCounter]                                                                                 //
+// ============================================================================================== //
+
+/**
+ * @brief   Counts events, some of which are timed.
+ */
+class TimedCounter : public Utils::NonCopyable
+{
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_samples;
+    std::atomic<uint64_t> m_sampledNs;
+public:
+    TimedCounter() : m_count(0), m_samples(0), m_sampledNs(0) {}
+public:
+    void add() { m_count.fetch_add(1, std::memory_order_relaxed); }
+    void addSample(uint64_t ns)
+    {
+        m_samples.fetch_add(1, std::memory_order_relaxed);
+        m_sampledNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t samples() const { return m_samples.load(std::memory_order_relaxed); }
+    /**
+     * @brief   Returns the time all events took, extrapolated from the timed ones.
+     */
+    uint64_t estimatedNs() const;
+};
+
+/**
+ * @brief   Counts an event for as long as it exists, timing it if sampled. Does nothing 
+ *          without a counter.
+ */
+class ScopedTimer : public Utils::NonCopyable
+{
+    TimedCounter* m_counter;
+    uint64_t m_start;
+public:
+    explicit ScopedTimer(TimedCounter* counter) 
+        : m_counter(counter)
+        , m_start(counter && StatisticsSampler::sample() ? StatisticsSampler::now() : 0)
+    {}
+    ~ScopedTimer()
+    {
+        if (!m_counter)
+            return;
+        m_counter->add();
+        if (m_start)
+            m_counter->addSample(StatisticsSampler::now() - m_start);
+    }
+};
+
+// ============================================================================================== //
+// [LatencyHistogram]                                                                             //
+// ============================================================================================== //
+
+/**
+ * @brief   Log-linear histogram of durations: four buckets per power of two nanoseconds, so
+ *          percentiles are accurate to within 25%.
+ */
+class LatencyHistogram : public Utils::NonCopyable
+{
+    static const unsigned kSubBucketBits = 2;
+    static const unsigned kBucketCount = 64 << kSubBucketBits;
+    std::atomic<uint32_t> m_counts[kBucketCount];
+public:
+    LatencyHistogram();
+public:
+    void record(uint64_t ns);
+    /**
+     * @brief   Returns the upper bound of the bucket holding the given percentile, in ns.
+     */
+    uint64_t percentile(double percent) const;
+};
+
+// ============================================================================================== //
+// [RuleStats]                                                                                    //
+// ============================================================================================== //
+
+/**
+ * @brief   Runtime statistics of a rule, updated concurrently by all threads applying it.
+ *
+ * Only the rules a name gets to count it: the names the prefilter keeps a rule away from are
+ * derived from the manager's count of names inspected since the rule was added.
+ */
+class RuleStats : public Utils::NonCopyable
+{
+    const uint64_t m_namesBefore;
+    std::atomic<uint64_t> m_selected;
+    TimedCounter m_evaluations;
+    std::atomic<uint64_t> m_matches;
+    std::atomic<uint64_t> m_rewrites;
+    // Allocated with the first sample, most rules are never timed.
+    std::atomic<LatencyHistogram*> m_histogram;
+public:
+    struct Snapshot
+    {
+        uint64_t evaluations;
+        uint64_t prefilterRejections;
+        uint64_t matches;
+        uint64_t rewrites;
+        uint64_t samples;
+        uint64_t estimatedNs;
+        uint64_t p99Ns;
+    };
+public:
+    /**
+     * @param   namesInspected  SubstitutionManager::namesInspected when the rule is added.
+     */
+    explicit RuleStats(uint64_t namesInspected);
+    ~RuleStats();
+public:
+    /**
+     * @brief   Counts a name the prefilter selected the rule for.
+     */
+    void countSelected() { m_selected.fetch_add(1, std::memory_order_relaxed); }
+    /**
+     * @brief   Counts an application of the rule to a name.
+     * @param   matches     Number of times the pattern matched.
+     * @param   rewrites    Number of rewrites charged to the budget.
+     * @param   ns          The time taken, zero if not sampled.
+     */
+    void countEvaluation(unsigned matches, unsigned rewrites, uint64_t ns);
+    Snapshot snapshot(uint64_t namesInspected) const;
+};
+
+// ============================================================================================== //
+// [HookStats]                                                                                    //
+// ============================================================================================== //
+
+/**
+ * @brief   Totals of the demangler hook. Pre-warming bypasses the hook and isn't counted.
+ */
+struct HookStats : public Utils::NonCopyable
+{
+    /**
+     * @brief   Calls of the hook, including those answered from a cache.
+     */
+    TimedCounter calls;
+    /**
+     * @brief   Calls of IDA's demangler.
+     */
+    TimedCounter demangler;
+    /**
+     * @brief   Substitutions of demangled names.
+     */
+    TimedCounter substitution;
+};
+
+// ============================================================================================== //
+// [StatisticsExporter]                                                                           //
+// ============================================================================================== //
+
+/**
+ * @brief   Dumps the rule and hook statistics as JSON or in the Prometheus text format.
+ */
+class StatisticsExporter : public Utils::NonCopyable
+{
+    const SubstitutionManager* m_manager;
+    const HookStats* m_hookStats;
+public:
+    class Error : public std::runtime_error
+        { public: explicit Error(const char *error) : runtime_error(error) {} };
+public:
+    /**
+     * @param   hookStats   The hook totals, may be @c nullptr.
+     */
+    StatisticsExporter(const SubstitutionManager* manager, const HookStats* hookStats);
+    virtual ~StatisticsExporter() {}
+    /**
+     * @throws  Error   If the file cannot be written.
+     */
+    void exportJson(const QString& path) const;
+    /**
+     * @throws  Error   If the file cannot be written.
+     */
+    void exportPrometheus(const QString& path) const;
+};
+
+// ============================================================================================== //
+
+#endif // STATISTICS_HPP
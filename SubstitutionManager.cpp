@@ -25,21 +25,224 @@
 #include "SubstitutionManager.hpp"
 
 #include "Settings.hpp"
+#include "ScratchArena.hpp"
+#include "TypeTree.hpp"
+#include "DefaultArguments.hpp"
+#include "Config.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <thread>
 #include <ida.hpp>
 #include <kernwin.hpp>
 #include <idp.hpp>
 
+namespace
+{
+
+/**
+ * @brief   Minimum number of rules compiled by each thread.
+ */
+const size_t kRulesPerThread = 16;
+
 // ============================================================================================== //
-// [SubstitutionManager]                                                                          //
+// [RewriteBudget]                                                                                //
+// ============================================================================================== //
+
+/**
+ * @brief   Limits the rewrites spent on a single name.
+ */
+class RewriteBudget
+{
+    unsigned m_iterationsLeft;
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_exhausted;
+public:
+    RewriteBudget(unsigned iterations, unsigned timeMs)
+        : m_iterationsLeft(iterations)
+        , m_deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeMs))
+        , m_exhausted(false)
+    {}
+
+    /**
+     * @brief   Accounts for one rewrite (a match or a replace-all pass).
+     * @return  @c false if the budget is exhausted and no further rewrite may happen.
+     */
+    bool consume()
+    {
+        if (!m_exhausted && (m_iterationsLeft == 0 
+                || std::chrono::steady_clock::now() >= m_deadline))
+            m_exhausted = true;
+        if (m_exhausted)
+            return false;
+
+        --m_iterationsLeft;
+        return true;
+    }
+
+    bool exhausted() const { return m_exhausted; }
+    unsigned iterationsLeft() const { return m_iterationsLeft; }
+};
+
+// ============================================================================================== //
+// [Rule application]                                                                             //
 // ============================================================================================== //
 
-const std::regex SubstitutionManager::m_kMarkerFinder 
-    = std::regex("\\$(\\d+)", std::regex_constants::optimize);
+/**
+ * @brief   Applies a match mode rule until it no longer matches or stops changing the name.
+ *          Adds the number of matches to @c matches.
+ */
+bool applyMatch(const Substitution& rule, char* str, size_t& length, uint outLen, 
+    RewriteBudget& budget, unsigned& matches)
+{
+    auto& arena = ScratchArena::local();
+    auto& groups = arena.groups();
+    auto& processed = arena.text();
+
+    bool rewritten = false;
+    while (rule.matcher->match(str, str + length, groups))
+    {
+        ++matches;
+        processed.clear();
+        rule.replacementTemplate.expand(groups, processed);
+        if (processed.size() == length && ::memcmp(processed.data(), str, length) == 0)
+            break;
+        if (!budget.consume())
+            break;
+
+        // Groups point into str, so the expansion can only be copied back afterwards.
+        length = std::min<size_t>(processed.size(), outLen - 1);
+        ::memcpy(str, processed.data(), length);
+        str[length] = '\0';
+        rewritten = true;
+    }
+    return rewritten;
+}
+
+/**
+ * @brief   Applies a replace-all mode rule until a pass no longer changes the name.
+ *          Adds the number of matches to @c matches.
+ */
+bool applyReplaceAll(const Substitution& rule, char* str, size_t& length, uint outLen, 
+    RewriteBudget& budget, unsigned& matches)
+{
+    auto& arena = ScratchArena::local();
+    auto& groups = arena.groups();
+    auto& processed = arena.text();
+
+    // A pass can only create new occurrences where it rewrote something. Text behind the last
+    // rewrite was already searched without result, so the next pass stops there.
+    size_t searchLimit = length;
+    bool rewritten = false;
+    for (;;)
+    {
+        processed.clear();
+        size_t copied = 0;
+        size_t lastRewriteEnd = 0;
+        bool passRewritten = false;
+        const char* from = str;
+        const char* const end = str + length;
+        while (from <= end && static_cast<size_t>(from - str) <= searchLimit 
+            && rule.matcher->search(str, end, from, groups))
+        {
+            const auto matchBegin = groups[0].begin;
+            const auto matchEnd = groups[0].end;
+            if (static_cast<size_t>(matchBegin - str) > searchLimit)
+                break;
+            ++matches;
+
+            processed.append(str + copied, matchBegin - (str + copied));
+            const auto expansionBegin = processed.size();
+            rule.replacementTemplate.expand(groups, processed);
+            copied = matchEnd - str;
+
+            // An unchanged expansion doesn't create anything new for the next pass.
+            if (processed.compare(expansionBegin, std::string::npos, 
+                    matchBegin, matchEnd - matchBegin) != 0)
+            {
+                lastRewriteEnd = processed.size();
+                passRewritten = true;
+            }
+
+            // Step over empty matches so the search makes progress.
+            if (matchBegin == matchEnd)
+            {
+                if (matchEnd == end)
+                    break;
+                processed.push_back(*matchEnd);
+                ++copied;
+                from = matchEnd + 1;
+            }
+            else
+            {
+                from = matchEnd;
+            }
+        }
+
+        if (!passRewritten || !budget.consume())
+            break;
+
+        processed.append(str + copied, length - copied);
+        length = std::min<size_t>(processed.size(), outLen - 1);
+        ::memcpy(str, processed.data(), length);
+        str[length] = '\0';
+        rewritten = true;
+
+        if (length != processed.size())
+            break;
+        searchLimit = lastRewriteEnd;
+    }
+    return rewritten;
+}
+
+// ============================================================================================== //
+
+}
+
+// ============================================================================================== //
+// [Substitution]                                                                                 //
+// ============================================================================================== //
+
+const char* Substitution::modeName(Mode mode)
+{
+    switch (mode)
+    {
+        case kModeReplaceAll:
+            return "replace-all";
+        case kModeType:
+            return "type";
+        default:
+            return "match";
+    }
+}
+
+Substitution::Mode Substitution::modeFromName(const std::string& name)
+{
+    if (name == "replace-all")
+        return kModeReplaceAll;
+    if (name == "type")
+        return kModeType;
+    return kModeMatch;
+}
+
+// ============================================================================================== //
+// [SubstitutionManager]                                                                          //
+// ============================================================================================== //
 
 SubstitutionManager::SubstitutionManager()
+    : m_generation(0)
+    , m_backend(RegexBackend::kStdRegex)
+    , m_updateDepth(0)
+    , m_rebuildPending(false)
+    , m_changePending(false)
+    , m_iterationBudget(kDefaultIterationBudget)
+    , m_timeBudgetMs(kDefaultTimeBudgetMs)
+    , m_elideDefaultArguments(false)
+    , m_namesInspected(0)
 {
-    
+    rebuildRuleSet();
 }
 
 SubstitutionManager::~SubstitutionManager()
@@ -47,10 +250,48 @@ SubstitutionManager::~SubstitutionManager()
     
 }
 
+void SubstitutionManager::beginUpdate()
+{
+    ++m_updateDepth;
+}
+
+void SubstitutionManager::commitUpdate()
+{
+    assert(m_updateDepth);
+    if (--m_updateDepth)
+        return;
+
+    if (m_rebuildPending)
+    {
+        m_rebuildPending = false;
+        rebuildRuleSet();
+    }
+    if (m_changePending)
+    {
+        m_changePending = false;
+        emit rulesChanged();
+    }
+}
+
 void SubstitutionManager::addRule(const std::shared_ptr<Substitution> subst)
 {
+    prepareRule(*subst, false);
     m_rules.push_back(std::move(subst));
-    emit entryAdded();
+    modified(true);
+}
+
+void SubstitutionManager::addRules(const SubstitutionList& substs, bool analyzed)
+{
+    if (substs.empty())
+        return;
+
+    m_rules.reserve(m_rules.size() + substs.size());
+    for (auto it = substs.cbegin(), end = substs.cend(); it != end; ++it)
+    {
+        prepareRule(**it, analyzed);
+        m_rules.push_back(*it);
+    }
+    modified(true);
 }
 
 void SubstitutionManager::removeRule(const Substitution* subst)
@@ -60,7 +301,7 @@ void SubstitutionManager::removeRule(const Substitution* subst)
         if (it->get() == subst)
         {
             it = m_rules.erase(it);
-            emit entryDeleted();
+            modified(true);
             if (it == m_rules.end())
                 break;
         }
@@ -72,38 +313,257 @@ void SubstitutionManager::clearRules()
     if (m_rules.size())
     {
         m_rules.clear();
-        emit entryDeleted();
+        modified(true);
     }
 }
 
-void SubstitutionManager::applyToString(char* str, uint outLen) const
+void SubstitutionManager::setBackend(RegexBackend::Kind backend)
 {
+    if (backend == m_backend)
+        return;
+
+    std::vector<std::shared_ptr<const Matcher>> matchers;
+    matchers.reserve(m_rules.size());
     for (auto it = m_rules.cbegin(), end = m_rules.cend(); it != end; ++it)
     {
-        std::cmatch groups;
-        while (std::regex_match(str, groups, (*it)->regexp))
+        matchers.push_back((*it)->mode == Substitution::kModeType ? (*it)->matcher 
+            : RegexBackend::compile(backend, (*it)->regexpPattern));
+    }
+
+    // Published rules are immutable, swap in modified copies.
+    m_backend = backend;
+    for (size_t i = 0; i < m_rules.size(); ++i)
+    {
+        auto copy = std::make_shared<Substitution>(*m_rules[i]);
+        copy->matcher = std::move(matchers[i]);
+        m_rules[i] = std::move(copy);
+    }
+    modified(false);
+}
+
+void SubstitutionManager::setRewriteBudget(unsigned iterations, unsigned timeMs)
+{
+    m_iterationBudget = iterations;
+    m_timeBudgetMs = timeMs;
+}
+
+std::shared_ptr<const Matcher> SubstitutionManager::compilePattern(
+    const std::string& pattern, Substitution::Mode mode) const
+{
+    if (mode == Substitution::kModeType)
+        return std::make_shared<TypePattern>(pattern);
+    return RegexBackend::compile(m_backend, pattern);
+}
+
+std::vector<std::string> SubstitutionManager::compileRules(const SubstitutionList& substs, 
+    bool lazily) const
+{
+    // Reported from whatever thread first applies the rule, once per rule.
+    auto reportInvalid = [](const std::string& pattern, const std::string& error)
+    {
+        msg("[" PLUGIN_NAME "] Rule \"%s\" is disabled, invalid pattern: %s\n", 
+            pattern.c_str(), error.c_str());
+    };
+
+    // Every rule has its own slot, so the outcome doesn't depend on the scheduling.
+    std::vector<std::string> errors(substs.size());
+    std::atomic<size_t> next(0);
+    auto work = [&]
+    {
+        for (size_t idx; (idx = next++) < substs.size(); )
         {
-            auto processed = (*it)->replacement;
-            std::smatch markerGroups;
-            while (std::regex_search(processed, markerGroups, m_kMarkerFinder))
+            auto& subst = *substs[idx];
+            unsigned groupCount;
+            try
             {
-                assert(markerGroups.size() == 2);
-                auto idx = static_cast<unsigned int>(std::stoi(markerGroups[1]));
-                if (idx >= groups.size())
-                    break;
+                if (lazily && subst.mode != Substitution::kModeType 
+                        && PatternAnalysis::countCaptureGroups(subst.regexpPattern, groupCount))
+                    subst.matcher = RegexBackend::compileLazily(m_backend, subst.regexpPattern,
+                        groupCount, std::vector<std::string>(), reportInvalid);
+                else
+                    subst.matcher = compilePattern(subst.regexpPattern, subst.mode);
+            }
+            catch (const Matcher::Error& e)
+            {
+                subst.matcher.reset();
+                errors[idx] = e.what();
+            }
+        }
+    };
+
+    // Small batches aren't worth a thread.
+    const unsigned cores = std::max(std::thread::hardware_concurrency(), 1U);
+    const auto threadCount = std::min<size_t>(cores, (substs.size() + kRulesPerThread - 1) 
+        / kRulesPerThread);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(work);
+    work();
+    for (auto it = threads.begin(), end = threads.end(); it != end; ++it)
+        it->join();
+    return errors;
+}
+
+void SubstitutionManager::prepareRule(Substitution& subst, bool analyzed) const
+{
+    subst.replacementTemplate = ReplacementTemplate(subst.replacement, 
+        subst.matcher->groupCount(), subst.matcher->groupNames());
+    subst.stats = std::make_shared<RuleStats>(m_namesInspected);
+    if (analyzed)
+        return;
+
+    subst.requiredLiterals = subst.mode == Substitution::kModeType 
+        ? TypePattern::requiredLiterals(subst.regexpPattern) 
+        : PatternAnalysis::requiredLiterals(subst.regexpPattern);
+    subst.mangledGuards = subst.declaredGuards.empty() 
+        ? PatternAnalysis::mangledGuards(subst.requiredLiterals) : subst.declaredGuards;
+}
+
+void SubstitutionManager::modified(bool rulesEdited)
+{
+    m_changePending |= rulesEdited;
+    if (m_updateDepth)
+    {
+        m_rebuildPending = true;
+        return;
+    }
+
+    rebuildRuleSet();
+    if (m_changePending)
+    {
+        m_changePending = false;
+        emit rulesChanged();
+    }
+}
+
+void SubstitutionManager::rebuildRuleSet()
+{
+    const auto generation = m_generation + 1;
+    m_ruleSet.update(std::unique_ptr<RuleSet>(new RuleSet(m_rules, generation)));
+    m_generation = generation;
+}
+
+bool SubstitutionManager::applyToString(char* str, uint outLen) const
+{
+    Snapshot ruleSet(m_ruleSet);
+    return applyToString(*ruleSet, str, outLen);
+}
+
+bool SubstitutionManager::applyToString(const RuleSet& ruleSet, char* str, uint outLen, 
+    const MangledName* mangled, RewriteTrace* trace) const
+{
+    m_namesInspected.fetch_add(1, std::memory_order_relaxed);
+    if (mangled && !mayApply(ruleSet, *mangled))
+        return false;
+
+    auto& arena = ScratchArena::local();
+    ScratchArena::Scope scope(arena);
+    auto& worklist = arena.worklist();
+    auto& candidates = arena.candidates();
+
+    const auto& rules = ruleSet.rules();
+    size_t length = ::strlen(str);
+    RewriteBudget budget(m_iterationBudget, m_timeBudgetMs);
+
+    // Pending rules in descending order, the next one to apply is at the back.
+    ruleSet.findCandidates(str, str + length, worklist, arena.literalHits());
+    for (auto it = worklist.cbegin(), end = worklist.cend(); it != end; ++it)
+        rules[*it]->stats->countSelected();
+    std::reverse(worklist.begin(), worklist.end());
+
+    bool anyRewritten = false;
+    for (;;)
+    {
+        while (!worklist.empty())
+        {
+            const auto current = worklist.back();
+            worklist.pop_back();
+
+            const auto& rule = *rules[current];
+            const auto started = StatisticsSampler::sample() ? StatisticsSampler::now() : 0;
+            const auto iterationsLeft = budget.iterationsLeft();
+            unsigned matches = 0;
+            const bool rewritten = rule.mode == Substitution::kModeMatch 
+                ? applyMatch(rule, str, length, outLen, budget, matches) 
+                : applyReplaceAll(rule, str, length, outLen, budget, matches);
+            rule.stats->countEvaluation(matches, iterationsLeft - budget.iterationsLeft(), 
+                started ? std::max<uint64_t>(StatisticsSampler::now() - started, 1) : 0);
 
-                size_t pos = 0;
-                std::string search = markerGroups[0];
-                std::string replace = groups[idx];
-                while((pos = processed.find(search, pos)) != std::string::npos) 
-                {
-                    processed.replace(pos, search.length(), replace);
-                    pos += replace.length();
-                }
+            anyRewritten |= rewritten;
+            if (rewritten && trace)
+                trace->rules.push_back(&rule);
+            if (budget.exhausted())
+            {
+                if (trace)
+                    trace->stoppedEarly = true;
+                reportNonConverging(rule, str);
+                return anyRewritten;
+            }
+            if (!rewritten)
+                continue;
+
+            // Reschedule the dependents that can still match the rewritten string.
+            ruleSet.findCandidates(str, str + length, candidates, arena.literalHits());
+            const auto& dependents = ruleSet.dependents(current);
+            for (auto it = candidates.cbegin(), end = candidates.cend(); it != end; ++it)
+            {
+                if (*it == current)
+                    continue;
+                if (!ruleSet.affectsAll(current) 
+                        && !std::binary_search(dependents.cbegin(), dependents.cend(), *it))
+                    continue;
+
+                auto pos = std::lower_bound(worklist.begin(), worklist.end(), *it, 
+                    std::greater<unsigned>());
+                if (pos == worklist.end() || *pos != *it)
+                    worklist.insert(pos, *it);
             }
-            ::qstrncpy(str, processed.c_str(), outLen);
         }
+
+        // Elision runs on the rules' result, so existing rules written against the full
+        // argument lists keep working. Rules may in turn match the shortened name.
+        if (!m_elideDefaultArguments)
+            break;
+        auto& unelided = arena.unelided();
+        if (trace)
+            unelided.assign(str, length);
+        if (!DefaultArgumentElider::instance().apply(str, length))
+            break;
+        anyRewritten = true;
+        if (trace)
+            trace->elidedFrom.push_back(unelided);
+        if (!budget.consume())
+        {
+            if (trace)
+                trace->stoppedEarly = true;
+            break;
+        }
+
+        ruleSet.findCandidates(str, str + length, worklist, arena.literalHits());
+        std::reverse(worklist.begin(), worklist.end());
     }
+
+    return anyRewritten;
+}
+
+bool SubstitutionManager::mayApply(const RuleSet& ruleSet, const MangledName& mangled) const
+{
+    // Only templates have defaulted arguments, MSVC mangles their names as "?$name@".
+    return ruleSet.mayApplyToMangled(mangled.str) 
+        || (m_elideDefaultArguments 
+            && (mangled.str[0] != '?' || ::strstr(mangled.str, "?$")));
+}
+
+void SubstitutionManager::reportNonConverging(const Substitution& rule, const char* str) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_reportedMutex);
+        if (!m_reportedPatterns.insert(rule.regexpPattern).second)
+            return;
+    }
+
+    msg("[" PLUGIN_NAME "] Rule \"%s\" does not converge, stopped rewriting \"%.100s\"\n",
+        rule.regexpPattern.c_str(), str);
 }
 
 // ============================================================================================== //
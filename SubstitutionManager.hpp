@@ -26,9 +26,16 @@
 #define SUBSTITUTIONMANAGER_HPP
 
 #include "Utils.hpp"
+#include "RuleSet.hpp"
+#include "ReplacementTemplate.hpp"
+#include "RegexBackend.hpp"
+#include "PatternAnalysis.hpp"
+#include "Statistics.hpp"
 
 #include <QDialog>
-#include <regex>
+#include <atomic>
+#include <mutex>
+#include <set>
 #include <vector>
 #include <QObject>
 
@@ -38,9 +45,66 @@
 
 struct Substitution
 {
+    // The values are also the indices of the modes in the editor.
+    enum Mode
+    {
+        /**
+         * @brief   The pattern must match the entire name, repeated until it no longer does.
+         */
+        kModeMatch,
+        /**
+         * @brief   Every occurrence of the pattern is replaced in a left-to-right pass.
+         */
+        kModeReplaceAll,
+        /**
+         * @brief   The pattern is a TypePattern, every occurrence is replaced.
+         */
+        kModeType
+    };
+
     std::string regexpPattern;
-    std::regex regexp;
+    std::shared_ptr<const Matcher> matcher;
     std::string replacement;
+    ReplacementTemplate replacementTemplate;
+    /**
+     * @brief   Literals the pattern requires, determined when the rule is added.
+     */
+    PatternAnalysis::RequiredLiterals requiredLiterals;
+    /**
+     * @brief   Guards on the mangled name given by the user, derived if empty.
+     */
+    std::vector<std::string> declaredGuards;
+    /**
+     * @brief   Literals of which one occurs in the mangled form of every MSVC name the rule
+     *          can apply to, no guard if empty. Determined when the rule is added.
+     */
+    PatternAnalysis::Alternatives mangledGuards;
+    /**
+     * @brief   Runtime statistics, created when the rule is added and shared by its copies.
+     */
+    std::shared_ptr<RuleStats> stats;
+    Mode mode;
+
+    Substitution() : mode(kModeMatch) {}
+
+    static const char* modeName(Mode mode);
+    /**
+     * @brief   Looks up a mode by its name, falling back to @c kModeMatch.
+     */
+    static Mode modeFromName(const std::string& name);
+};
+
+// ============================================================================================== //
+// [MangledName]                                                                                  //
+// ============================================================================================== //
+
+/**
+ * @brief   The demangler call a name is the result of.
+ */
+struct MangledName
+{
+    const char* str;
+    uint32_t disableMask;
 };
 
 // ============================================================================================== //
@@ -53,22 +117,159 @@ class SubstitutionManager : public QObject, public Utils::NonCopyable
 
 public:
     typedef std::vector<std::shared_ptr<Substitution>> SubstitutionList;
+    typedef Utils::RcuPointer<RuleSet>::ReadGuard Snapshot;
+
+    static const unsigned kDefaultIterationBudget = 1024;
+    static const unsigned kDefaultTimeBudgetMs = 50;
+
+    /**
+     * @brief   Groups modifications for as long as it exists, see beginUpdate.
+     */
+    class Transaction : public Utils::NonCopyable
+    {
+        SubstitutionManager& m_manager;
+    public:
+        explicit Transaction(SubstitutionManager& manager) 
+            : m_manager(manager) { m_manager.beginUpdate(); }
+        ~Transaction() { m_manager.commitUpdate(); }
+    };
 protected:
-    static const std::regex m_kMarkerFinder;
+    // Owned by the thread editing the rules. Other threads only access published snapshots.
     SubstitutionList m_rules;
+    Utils::RcuPointer<RuleSet> m_ruleSet;
+    std::atomic<unsigned> m_generation;
+    RegexBackend::Kind m_backend;
+    unsigned m_updateDepth;
+    bool m_rebuildPending;
+    bool m_changePending;
+    std::atomic<unsigned> m_iterationBudget;
+    std::atomic<unsigned> m_timeBudgetMs;
+    std::atomic<bool> m_elideDefaultArguments;
+    mutable std::atomic<uint64_t> m_namesInspected;
+    mutable std::mutex m_reportedMutex;
+    mutable std::set<std::string> m_reportedPatterns;
 public:
     SubstitutionManager();
     ~SubstitutionManager();
 public:
+    /**
+     * @brief   Starts a transaction. Until the matching commitUpdate, modifications neither 
+     *          publish a new rule set nor emit @c rulesChanged. Transactions may be nested.
+     */
+    void beginUpdate();
+    /**
+     * @brief   Ends a transaction. Ending the outermost one publishes the modifications, if 
+     *          any, in a single rule set and emits @c rulesChanged once.
+     */
+    void commitUpdate();
     void addRule(const std::shared_ptr<Substitution> subst);
+    /**
+     * @brief   Adds several rules, rebuilding the rule set once.
+     * @param   analyzed    Whether the rules' required literals and mangled guards are
+     *                      already determined, e.g. because they were loaded from an archive.
+     */
+    void addRules(const SubstitutionList& substs, bool analyzed = false);
     void removeRule(const Substitution* subst);
     void clearRules();
     const SubstitutionList& rules() const { return m_rules; }
+    RegexBackend::Kind backend() const { return m_backend; }
+    /**
+     * @brief   Switches the regex backend, recompiling all rules.
+     * @throws  Matcher::Error  If any rule cannot be compiled by the new backend. The rule set
+     *                          is left unchanged in that case.
+     */
+    void setBackend(RegexBackend::Kind backend);
+    /**
+     * @brief   Compiles a pattern using the current backend, or as a type pattern.
+     * @throws  Matcher::Error  If the pattern is invalid.
+     */
+    std::shared_ptr<const Matcher> compilePattern(const std::string& pattern, 
+        Substitution::Mode mode = Substitution::kModeMatch) const;
+    /**
+     * @brief   Compiles the patterns of several rules on all cores, setting their matchers.
+     * @param   lazily  Whether to defer compiling regular expressions until the prefilter 
+     *                  first selects a rule, see RegexBackend::compileLazily. Errors surfacing
+     *                  then are reported to the output window. Patterns whose groups cannot be
+     *                  counted in advance are compiled right away.
+     * @return  The error compiling each rule, in the order of @c substs. Empty for the rules
+     *          compiled successfully.
+     */
+    std::vector<std::string> compileRules(const SubstitutionList& substs, 
+        bool lazily = false) const;
+    /**
+     * @brief   Returns a counter that changes whenever the rule set is modified.
+     */
+    unsigned generation() const { return m_generation; }
+    /**
+     * @brief   Limits the work spent on a single name. Rules still matching when either limit
+     *          is hit are reported and the name is left as far as it got.
+     * @param   iterations  Maximum number of rewrites (matches or replace-all passes).
+     * @param   timeMs      Maximum time in milliseconds.
+     */
+    void setRewriteBudget(unsigned iterations, unsigned timeMs);
+    unsigned iterationBudget() const { return m_iterationBudget; }
+    unsigned timeBudgetMs() const { return m_timeBudgetMs; }
+    /**
+     * @brief   Enables the built-in pass removing defaulted template arguments, off by default.
+     * @see     DefaultArgumentElider
+     */
+    void setElideDefaultArguments(bool elide) { m_elideDefaultArguments = elide; }
+    bool elideDefaultArguments() const { return m_elideDefaultArguments; }
+    /**
+     * @brief   Returns the number of names the rules were applied to so far, see RuleStats.
+     */
+    uint64_t namesInspected() const { return m_namesInspected; }
+    /**
+     * @brief   Returns the published rule sets. Constructing a Snapshot from it never blocks;
+     *          the rule set stays valid and unchanged while the snapshot exists, even if the 
+     *          rules are edited meanwhile.
+     */
+    const Utils::RcuPointer<RuleSet>& ruleSet() const { return m_ruleSet; }
 public:
-    void applyToString(char* str, uint outLen) const;
+    /**
+     * @brief   Applies all rules of the current rule set to a string in place.
+     *
+     * The rules are applied in list order. Whenever a rule rewrites the string, the rules
+     * depending on it are scheduled again, until no rule changes the string anymore or the 
+     * rewrite budget is exhausted. Then defaulted template arguments are elided, if enabled;
+     * if that changes the string, the rules still matching it are applied again.
+     *
+     * @return  @c true if any rule or the elision rewrote the string.
+     */
+    bool applyToString(char* str, uint outLen) const;
+    /**
+     * @brief   Applies all rules of a snapshot to a string in place.
+     * @param   mangled The name @c str was demangled from, if known. If none of the rules'
+     *                  guards occurs in it (see RuleSet::mayApplyToMangled), the string isn't
+     *                  inspected at all.
+     * @param   trace   Receives the rules that rewrote the string and the string before 
+     *                  each elision, optional. It is not cleared first.
+     * @return  @c true if any rule rewrote the string.
+     */
+    bool applyToString(const RuleSet& ruleSet, char* str, uint outLen, 
+        const MangledName* mangled = nullptr, RewriteTrace* trace = nullptr) const;
+protected:
+    void prepareRule(Substitution& subst, bool analyzed) const;
+    /**
+     * @brief   Publishes modified rules, or defers it until the transaction is committed.
+     * @param   rulesEdited Whether the rules themselves changed rather than how they are
+     *                      compiled, emitting @c rulesChanged.
+     */
+    void modified(bool rulesEdited);
+    void rebuildRuleSet();
+    /**
+     * @brief   Determines whether a rule or the elision may apply to a demangled name.
+     */
+    bool mayApply(const RuleSet& ruleSet, const MangledName& mangled) const;
+    /**
+     * @brief   Reports a rule that exhausted the rewrite budget, once per pattern.
+     */
+    void reportNonConverging(const Substitution& rule, const char* str) const;
 signals:
-    void entryAdded();
-    void entryDeleted();
+    /**
+     * @brief   Emitted when rules were added or removed, once per transaction.
+     */
+    void rulesChanged();
 };
 
 // ============================================================================================== //
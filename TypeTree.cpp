@@ -0,0 +1,496 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "TypeTree.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace
+{
+
+bool isIdentifierChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isOperatorChar(char c)
+{
+    return std::strchr("+-*/%^&|~!=<>,", c) != nullptr && c != '\0';
+}
+
+bool isElaborated(const char* begin, const char* end)
+{
+    static const char* const kKeywords[] = { "class", "struct", "union", "enum" };
+    const size_t length = end - begin;
+    for (size_t i = 0; i < sizeof(kKeywords) / sizeof(*kKeywords); ++i)
+    {
+        if (::strlen(kKeywords[i]) == length && ::memcmp(kKeywords[i], begin, length) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief   Skips an MSVC quoted name ("`...'"), which may nest.
+ */
+const char* skipQuoted(const char* cur, const char* end)
+{
+    unsigned depth = 0;
+    for (; cur != end; ++cur)
+    {
+        if (*cur == '`')
+            ++depth;
+        else if (*cur == '\'' && --depth == 0)
+            return cur + 1;
+    }
+    return end;
+}
+
+/**
+ * @brief   Skips the symbol following the keyword "operator", if any.
+ */
+const char* skipOperatorSymbol(const char* cur, const char* end)
+{
+    const char* symbol = cur;
+    while (symbol != end && *symbol == ' ')
+        ++symbol;
+    if (symbol == end)
+        return cur;
+
+    if ((*symbol == '(' || *symbol == '[') && symbol + 1 != end 
+            && symbol[1] == (*symbol == '(' ? ')' : ']'))
+        return symbol + 2;
+
+    const char* symbolEnd = symbol;
+    while (symbolEnd != end && isOperatorChar(*symbolEnd))
+        ++symbolEnd;
+    return symbolEnd != symbol ? symbolEnd : cur;
+}
+
+/**
+ * @brief   Returns the parse of a subject, cached per thread.
+ *
+ * Replace-all passes search the same text over and over, starting further behind each time.
+ * The copy of the text detects when it was modified in place in between.
+ */
+const TypeTree& parsedSubject(const char* begin, const char* end)
+{
+    struct Cache
+    {
+        TypeTree tree;
+        std::string text;
+        const char* begin;
+        Cache() : begin(nullptr) {}
+    };
+    static thread_local Cache cache;
+
+    const size_t length = end - begin;
+    if (cache.begin != begin || cache.text.size() != length 
+        || ::memcmp(cache.text.data(), begin, length) != 0)
+    {
+        cache.tree.parse(begin, end, false);
+        cache.text.assign(begin, end);
+        cache.begin = begin;
+    }
+    return cache.tree;
+}
+
+}
+
+// ============================================================================================== //
+// [TypeTree]                                                                                     //
+// ============================================================================================== //
+
+const uint32_t TypeTree::kNone;
+
+void TypeTree::parse(const char* begin, const char* end, bool variables)
+{
+    m_tokens.clear();
+
+    const char* cur = begin;
+    while (cur != end)
+    {
+        const char c = *cur;
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            ++cur;
+            continue;
+        }
+
+        Token token = { kPunctuation, cur, cur + 1, kNone, kNone, false };
+        if (isIdentifierChar(c) 
+            || (c == '~' && cur + 1 != end && isIdentifierChar(cur[1]))
+            || (variables && c == '$' && cur + 1 != end && isIdentifierChar(cur[1])))
+        {
+            token.kind = c == '$' ? kVariable : kIdentifier;
+            token.end = cur + 1;
+            while (token.end != end && isIdentifierChar(*token.end))
+                ++token.end;
+            if (token.end - cur == 8 && ::memcmp(cur, "operator", 8) == 0)
+                token.end = skipOperatorSymbol(token.end, end);
+            token.elaborated = isElaborated(token.begin, token.end);
+        }
+        else if (c == '`')
+        {
+            token.kind = kIdentifier;
+            token.end = skipQuoted(cur, end);
+        }
+        else if (c == ':' && cur + 1 != end && cur[1] == ':')
+        {
+            token.kind = kScope;
+            token.end = cur + 2;
+        }
+        else if (c == '&' && cur + 1 != end && cur[1] == '&')
+        {
+            token.end = cur + 2;
+        }
+        else
+        {
+            switch (c)
+            {
+                case ',': token.kind = kComma; break;
+                case '<': token.kind = kOpenAngle; break;
+                case '>': token.kind = kCloseAngle; break;
+                case '(': token.kind = kOpenParen; break;
+                case ')': token.kind = kCloseParen; break;
+                case '[': token.kind = kOpenBracket; break;
+                case ']': token.kind = kCloseBracket; break;
+                default: break;
+            }
+        }
+
+        m_tokens.push_back(token);
+        cur = token.end;
+    }
+
+    // Pair the brackets. A closing bracket not matching the innermost open one is left 
+    // unpaired.
+    const auto count = static_cast<uint32_t>(m_tokens.size());
+    auto& open = m_open;
+    open.clear();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto& token = m_tokens[i];
+        if (isOpening(token.kind))
+        {
+            open.push_back(i);
+        }
+        else if (isClosing(token.kind) && !open.empty() 
+            && m_tokens[open.back()].kind + 1 == token.kind)
+        {
+            token.partner = open.back();
+            m_tokens[open.back()].partner = i;
+            open.pop_back();
+        }
+    }
+
+    // Find the end of every argument walking backwards: a closing bracket starts a new level,
+    // its partner returns to the enclosing one.
+    auto& enclosing = m_enclosing;
+    enclosing.clear();
+    uint32_t argumentEnd = count;
+    for (uint32_t i = count; i-- > 0; )
+    {
+        auto& token = m_tokens[i];
+        if (isClosing(token.kind))
+        {
+            token.argumentEnd = argumentEnd;
+            if (token.partner != kNone)
+                enclosing.push_back(argumentEnd);
+            argumentEnd = i;
+        }
+        else if (isOpening(token.kind) && token.partner != kNone)
+        {
+            argumentEnd = enclosing.back();
+            enclosing.pop_back();
+            token.argumentEnd = argumentEnd;
+        }
+        else if (token.kind == kComma)
+        {
+            token.argumentEnd = i;
+            argumentEnd = i;
+        }
+        else
+        {
+            token.argumentEnd = argumentEnd;
+        }
+    }
+}
+
+bool TypeTree::equivalent(uint32_t begin1, uint32_t end1, uint32_t begin2, uint32_t end2) const
+{
+    for (;;)
+    {
+        while (begin1 != end1 && m_tokens[begin1].elaborated)
+            ++begin1;
+        while (begin2 != end2 && m_tokens[begin2].elaborated)
+            ++begin2;
+        if (begin1 == end1 || begin2 == end2)
+            return begin1 == end1 && begin2 == end2;
+        if (!sameToken(m_tokens[begin1++], m_tokens[begin2++]))
+            return false;
+    }
+}
+
+bool TypeTree::sameToken(const Token& token1, const Token& token2)
+{
+    return token1.kind == token2.kind && token1.end - token1.begin == token2.end - token2.begin
+        && ::memcmp(token1.begin, token2.begin, token1.end - token1.begin) == 0;
+}
+
+bool TypeTree::isOpening(TokenKind kind)
+{
+    return kind == kOpenAngle || kind == kOpenParen || kind == kOpenBracket;
+}
+
+bool TypeTree::isClosing(TokenKind kind)
+{
+    return kind == kCloseAngle || kind == kCloseParen || kind == kCloseBracket;
+}
+
+// ============================================================================================== //
+// [TypePattern]                                                                                  //
+// ============================================================================================== //
+
+TypePattern::TypePattern(const std::string& pattern)
+    : m_text(pattern)
+{
+    m_pattern.parse(m_text.data(), m_text.data() + m_text.size(), true);
+
+    // Elaborated type specifiers are insignificant, drop them.
+    std::vector<TypeTree::Token> tokens;
+    for (auto it = m_pattern.tokens().cbegin(), end = m_pattern.tokens().cend(); it != end; ++it)
+    {
+        if (!it->elaborated)
+            tokens.push_back(*it);
+    }
+    if (tokens.empty())
+        throw Error("empty type pattern");
+
+    // Reparse the remaining text to get the pairing right after dropping tokens.
+    std::string normalized;
+    for (auto it = tokens.cbegin(), end = tokens.cend(); it != end; ++it)
+    {
+        if (!normalized.empty())
+            normalized += ' ';
+        normalized.append(it->begin, it->end);
+    }
+    m_text.swap(normalized);
+    m_pattern.parse(m_text.data(), m_text.data() + m_text.size(), true);
+
+    for (uint32_t i = 0; i < m_pattern.size(); ++i)
+    {
+        const auto& token = m_pattern[i];
+        if ((TypeTree::isOpening(token.kind) || TypeTree::isClosing(token.kind)) 
+                && token.partner == TypeTree::kNone)
+            throw Error("unbalanced brackets in type pattern");
+
+        if (token.kind != TypeTree::kVariable)
+        {
+            m_variableIndices.push_back(TypeTree::kNone);
+            m_wholeArgument.push_back(false);
+            continue;
+        }
+
+        const std::string name(token.begin + 1, token.end);
+        uint32_t index = 0;
+        while (index < m_variables.size() && m_variables[index] != name)
+            ++index;
+        if (index == m_variables.size())
+        {
+            if (m_variables.size() + 1 >= MatchGroups::kMaxGroups)
+                throw Error("too many variables in type pattern");
+            m_variables.push_back(name);
+        }
+        m_variableIndices.push_back(index);
+
+        // Alone between brackets or commas, the variable stands for an entire argument.
+        const bool argumentStart = i > 0 && (m_pattern[i - 1].kind == TypeTree::kComma 
+            || TypeTree::isOpening(m_pattern[i - 1].kind));
+        const bool argumentEnd = i + 1 < m_pattern.size() 
+            && (m_pattern[i + 1].kind == TypeTree::kComma 
+                || TypeTree::isClosing(m_pattern[i + 1].kind));
+        m_wholeArgument.push_back(argumentStart && argumentEnd);
+    }
+}
+
+unsigned TypePattern::groupCount() const
+{
+    return static_cast<unsigned>(m_variables.size());
+}
+
+const std::vector<std::string>& TypePattern::groupNames() const
+{
+    return m_variables;
+}
+
+uint32_t TypePattern::matchAt(const TypeTree& subject, uint32_t start, 
+    MatchGroups& groups) const
+{
+    uint32_t boundBegin[MatchGroups::kMaxGroups];
+    uint32_t boundEnd[MatchGroups::kMaxGroups];
+    for (size_t i = 0; i < m_variables.size(); ++i)
+        boundBegin[i] = TypeTree::kNone;
+
+    const auto subjectSize = static_cast<uint32_t>(subject.size());
+    uint32_t cur = start;
+    for (uint32_t i = 0; i < m_pattern.size(); ++i)
+    {
+        const auto& token = m_pattern[i];
+        if (token.kind != TypeTree::kVariable || !m_wholeArgument[i])
+        {
+            while (cur < subjectSize && subject[cur].elaborated)
+                ++cur;
+        }
+        if (cur >= subjectSize)
+            return TypeTree::kNone;
+
+        if (token.kind != TypeTree::kVariable)
+        {
+            if (!TypeTree::sameToken(token, subject[cur]))
+                return TypeTree::kNone;
+            ++cur;
+            continue;
+        }
+
+        // Bind the variable, to the argument or to a single component.
+        const auto& first = subject[cur];
+        uint32_t end;
+        if (m_wholeArgument[i])
+        {
+            if (first.kind == TypeTree::kComma || TypeTree::isClosing(first.kind))
+                return TypeTree::kNone;
+            end = first.argumentEnd;
+        }
+        else if (first.kind == TypeTree::kIdentifier)
+        {
+            // A qualified name, unless the pattern continues with a scope or arguments.
+            const auto next = i + 1 < m_pattern.size() ? m_pattern[i + 1].kind 
+                : TypeTree::kPunctuation;
+            end = cur;
+            for (;;)
+            {
+                ++end;
+                if (next != TypeTree::kOpenAngle && end < subjectSize 
+                    && subject[end].kind == TypeTree::kOpenAngle)
+                {
+                    if (subject[end].partner == TypeTree::kNone)
+                        return TypeTree::kNone;
+                    end = subject[end].partner + 1;
+                }
+                if (next == TypeTree::kScope || end + 1 >= subjectSize 
+                        || subject[end].kind != TypeTree::kScope 
+                        || subject[end + 1].kind != TypeTree::kIdentifier)
+                    break;
+                ++end;
+            }
+        }
+        else if (TypeTree::isOpening(first.kind) && first.partner != TypeTree::kNone)
+        {
+            end = first.partner + 1;
+        }
+        else
+        {
+            return TypeTree::kNone;
+        }
+
+        const auto variable = m_variableIndices[i];
+        if (boundBegin[variable] == TypeTree::kNone)
+        {
+            boundBegin[variable] = cur;
+            boundEnd[variable] = end;
+        }
+        else if (!subject.equivalent(boundBegin[variable], boundEnd[variable], cur, end))
+        {
+            return TypeTree::kNone;
+        }
+        cur = end;
+    }
+
+    groups.resize(groupCount() + 1);
+    MatchSpan whole = { subject[start].begin, subject[cur - 1].end };
+    groups[0] = whole;
+    for (size_t i = 0; i < m_variables.size(); ++i)
+    {
+        MatchSpan span = { subject[boundBegin[i]].begin, subject[boundEnd[i] - 1].end };
+        groups[static_cast<unsigned>(i + 1)] = span;
+    }
+    return cur;
+}
+
+bool TypePattern::match(const char* begin, const char* end, MatchGroups& groups) const
+{
+    const auto& subject = parsedSubject(begin, end);
+
+    uint32_t start = 0;
+    while (start < subject.size() && subject[start].elaborated)
+        ++start;
+    return start < subject.size() && matchAt(subject, start, groups) == subject.size();
+}
+
+bool TypePattern::search(const char* begin, const char* end, const char* from, 
+    MatchGroups& groups) const
+{
+    const auto& subject = parsedSubject(begin, end);
+    auto start = static_cast<uint32_t>(std::lower_bound(subject.tokens().cbegin(), 
+        subject.tokens().cend(), from, [](const TypeTree::Token& token, const char* pos)
+    {
+        return token.begin < pos;
+    }) - subject.tokens().cbegin());
+
+    // Never start inside a qualified name.
+    const auto& first = m_pattern[0];
+    for (; start < subject.size(); ++start)
+    {
+        const auto& token = subject[start];
+        if (token.elaborated || (start > 0 && subject[start - 1].kind == TypeTree::kScope))
+            continue;
+        if (first.kind != TypeTree::kVariable && !TypeTree::sameToken(first, token))
+            continue;
+        if (matchAt(subject, start, groups) != TypeTree::kNone)
+            return true;
+    }
+    return false;
+}
+
+PatternAnalysis::RequiredLiterals TypePattern::requiredLiterals(const std::string& pattern)
+{
+    TypeTree tree;
+    tree.parse(pattern.data(), pattern.data() + pattern.size(), true);
+
+    PatternAnalysis::RequiredLiterals required;
+    for (auto it = tree.tokens().cbegin(), end = tree.tokens().cend(); it != end; ++it)
+    {
+        if (it->kind != TypeTree::kIdentifier || it->elaborated)
+            continue;
+        PatternAnalysis::Alternatives literal(1, std::string(it->begin, it->end));
+        if (std::find(required.cbegin(), required.cend(), literal) == required.cend())
+            required.push_back(std::move(literal));
+    }
+    return required;
+}
+
+// ============================================================================================== //
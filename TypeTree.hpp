@@ -0,0 +1,174 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TYPETREE_HPP
+#define TYPETREE_HPP
+
+#include "RegexBackend.hpp"
+#include "PatternAnalysis.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================================== //
+// [TypeTree]                                                                                     //
+// ============================================================================================== //
+
+/**
+ * @brief   Lightweight syntax tree of a demangled C++ name.
+ *
+ * The name is split into tokens (identifiers, "::", brackets, commas and punctuation such as
+ * cv-qualifiers' companions "*" and "&"), and the brackets of template argument lists,
+ * parameter lists and array bounds are paired up. The pairing together with the end of the
+ * argument each token belongs to forms the tree; it is stored flat in the token array so
+ * parsing is a single linear pass without allocations once the buffers have grown.
+ *
+ * MSVC specifics are recognized: quoted names like "`anonymous namespace'" are single tokens
+ * and so are operator names ("operator<<", "operator()"). Elaborated type specifiers (class,
+ * struct, union, enum) are kept as tokens but ignored when comparing types.
+ */
+class TypeTree
+{
+public:
+    // Each closing bracket directly follows its opening counterpart.
+    enum TokenKind
+    {
+        kIdentifier,
+        kVariable,
+        kScope,
+        kComma,
+        kOpenAngle,
+        kCloseAngle,
+        kOpenParen,
+        kCloseParen,
+        kOpenBracket,
+        kCloseBracket,
+        kPunctuation
+    };
+
+    static const uint32_t kNone = UINT32_MAX;
+
+    struct Token
+    {
+        TokenKind kind;
+        const char* begin;
+        const char* end;
+        /**
+         * @brief   Index of the matching bracket, @c kNone for other tokens and unpaired ones.
+         */
+        uint32_t partner;
+        /**
+         * @brief   Index of the comma or closing bracket ending the argument the token is in.
+         */
+        uint32_t argumentEnd;
+        bool elaborated;
+    };
+private:
+    std::vector<Token> m_tokens;
+    std::vector<uint32_t> m_open;
+    std::vector<uint32_t> m_enclosing;
+public:
+    /**
+     * @brief   Parses a name. Unpaired brackets are tolerated, they are left without partner.
+     * @param   begin       Start of the name.
+     * @param   end         End of the name.
+     * @param   variables   Recognize "$Name" as variable tokens.
+     */
+    void parse(const char* begin, const char* end, bool variables);
+public:
+    const std::vector<Token>& tokens() const { return m_tokens; }
+    size_t size() const { return m_tokens.size(); }
+    const Token& operator [] (size_t idx) const { return m_tokens[idx]; }
+    /**
+     * @brief   Compares two token ranges, ignoring whitespace and elaborated type specifiers.
+     */
+    bool equivalent(uint32_t begin1, uint32_t end1, uint32_t begin2, uint32_t end2) const;
+    static bool sameToken(const Token& token1, const Token& token2);
+    static bool isOpening(TokenKind kind);
+    static bool isClosing(TokenKind kind);
+};
+
+// ============================================================================================== //
+// [TypePattern]                                                                                  //
+// ============================================================================================== //
+
+/**
+ * @brief   Structural pattern over type trees, the matcher of type rules.
+ *
+ * A pattern is written like the type it matches, "$Name" denotes a variable:
+ * 
+ *   std::basic_string<$T, std::char_traits<$T>, std::allocator<$T>>
+ *
+ * A variable making up an entire template or function argument binds that whole argument.
+ * Anywhere else it binds a qualified name including template arguments, or a bracketed
+ * group. If the pattern continues with "::" or "<", the variable binds a single name
+ * component or leaves out the template arguments, respectively, so "$Outer::iterator" and
+ * "$Container<$T>" work as expected. Variables used more than once must bind equivalent types.
+ * 
+ * Whitespace and elaborated type specifiers are insignificant, and a match never starts in
+ * the middle of a qualified name. Matching is a deterministic walk over the tokens without
+ * backtracking; variables bound to arguments are skipped in constant time using the tree, so
+ * the cost is linear in the name length for a given pattern, regardless of the nesting depth.
+ *
+ * Variables are exposed as capture groups in order of first appearance, named by 
+ * groupNames(), so replacements refer to them as "$Name".
+ */
+class TypePattern : public Matcher
+{
+    TypeTree m_pattern;
+    std::string m_text;
+    std::vector<std::string> m_variables;
+    std::vector<uint32_t> m_variableIndices;
+    std::vector<bool> m_wholeArgument;
+public:
+    /**
+     * @brief   Constructor.
+     * @throws  Matcher::Error  If the pattern is empty, has unbalanced brackets or too many
+     *                          variables.
+     */
+    explicit TypePattern(const std::string& pattern);
+public:
+    unsigned groupCount() const override;
+    const std::vector<std::string>& groupNames() const override;
+    bool match(const char* begin, const char* end, MatchGroups& groups) const override;
+    bool search(const char* begin, const char* end, const char* from, 
+        MatchGroups& groups) const override;
+    /**
+     * @brief   Determines the literals every match of a type pattern contains, its 
+     *          identifiers other than elaborated type specifiers.
+     * @return  The identifiers, empty if the pattern consists of variables only.
+     */
+    static PatternAnalysis::RequiredLiterals requiredLiterals(const std::string& pattern);
+protected:
+    /**
+     * @brief   Tries to match the pattern at a token of the subject.
+     * @return  One past the last matched token, or @c TypeTree::kNone.
+     */
+    uint32_t matchAt(const TypeTree& subject, uint32_t start, MatchGroups& groups) const;
+};
+
+// ============================================================================================== //
+
+#endif // TYPETREE_HPP
@@ -28,6 +28,7 @@
 #include "ImportExport.hpp"
 
 #include <cassert>
+#include <algorithm>
 #include <QMessageBox>
 #include <QFile>
 #include <QMenu>
@@ -38,6 +39,37 @@
 // [SubstitutionModel]                                                                            //
 // ============================================================================================== //
 
+namespace
+{
+    enum Column
+    {
+        kColumnPattern,
+        kColumnReplacement,
+        kColumnMode,
+        // Statistics, see RuleStats.
+        kColumnEvaluations,
+        kColumnRejections,
+        kColumnMatches,
+        kColumnRewrites,
+        kColumnTime,
+        kColumnP99,
+        kColumnCount
+    };
+
+    QString formatDuration(uint64_t ns)
+    {
+        const char* const units[] = { "ns", "us", "ms", "s" };
+        double value = static_cast<double>(ns);
+        unsigned unit = 0;
+        while (value >= 1000.0 && unit < 3)
+        {
+            value /= 1000.0;
+            ++unit;
+        }
+        return QString::number(value, 'f', unit ? 2 : 0) + " " + units[unit];
+    }
+}
+
 SubstitutionModel::SubstitutionModel(SubstitutionManager *data, QObject *parent)
     : QAbstractItemModel(parent)
     , m_substMgr(data)
@@ -52,7 +84,7 @@ int SubstitutionModel::rowCount(const QModelIndex &parent) const
 
 int SubstitutionModel::columnCount(const QModelIndex &/*parent*/) const
 {
-    return 2;
+    return kColumnCount;
 }
 
 QModelIndex SubstitutionModel::index(int row, int column, const QModelIndex &parent) const
@@ -62,13 +94,48 @@ QModelIndex SubstitutionModel::index(int row, int column, const QModelIndex &par
 
 QVariant SubstitutionModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || role != Qt::DisplayRole)
+    if (!index.isValid())
+        return QVariant();
+    if (role == Qt::TextAlignmentRole && index.column() >= kColumnEvaluations)
+        return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+    if (role != Qt::DisplayRole)
         return QVariant();
 
     assert(static_cast<unsigned>(index.row()) >= m_substMgr->rules().size());
     auto sbst = m_substMgr->rules().at(index.row());
-    return index.column() == 0 ? QString::fromStdString(sbst->regexpPattern)
-        : QString::fromStdString(sbst->replacement);
+    if (index.column() >= kColumnEvaluations)
+    {
+        const auto stats = sbst->stats->snapshot(m_substMgr->namesInspected());
+        switch (index.column())
+        {
+            case kColumnEvaluations:
+                return static_cast<qulonglong>(stats.evaluations);
+            case kColumnRejections:
+                return static_cast<qulonglong>(stats.prefilterRejections);
+            case kColumnMatches:
+                return static_cast<qulonglong>(stats.matches);
+            case kColumnRewrites:
+                return static_cast<qulonglong>(stats.rewrites);
+            case kColumnTime:
+                return stats.samples ? formatDuration(stats.estimatedNs) : QString();
+            case kColumnP99:
+                return stats.samples ? formatDuration(stats.p99Ns) : QString();
+            default:
+                return QVariant();
+        }
+    }
+
+    switch (index.column())
+    {
+        case kColumnPattern:
+            return QString::fromStdString(sbst->regexpPattern);
+        case kColumnReplacement:
+            return QString::fromStdString(sbst->replacement);
+        case kColumnMode:
+            return QString(Substitution::modeName(sbst->mode));
+        default:
+            return QVariant();
+    }
 }
 
 QVariant SubstitutionModel::headerData(int section, 
@@ -79,10 +146,24 @@ QVariant SubstitutionModel::headerData(int section,
 
     switch (section)
     {
-        case 0:
+        case kColumnPattern:
             return "Search text";
-        case 1:
+        case kColumnReplacement:
             return "Replacement";
+        case kColumnMode:
+            return "Mode";
+        case kColumnEvaluations:
+            return "Evaluations";
+        case kColumnRejections:
+            return "Prefiltered";
+        case kColumnMatches:
+            return "Matches";
+        case kColumnRewrites:
+            return "Rewrites";
+        case kColumnTime:
+            return "Time";
+        case kColumnP99:
+            return "p99";
         default:
             return QVariant();
     }
@@ -111,14 +192,34 @@ void SubstitutionModel::update()
     emit layoutChanged();
 }
 
+void SubstitutionModel::updateStatistics()
+{
+    if (rowCount() == 0)
+        return;
+    emit dataChanged(index(0, kColumnEvaluations), index(rowCount() - 1, kColumnCount - 1));
+}
+
 // ============================================================================================== //
 // [SubstitutionEditor]                                                                           //
 // ============================================================================================== //
 
+namespace
+{
+    const char* const kRuleFileFilter = "Rule file (*.ini);;JSON Lines rule file (*.jsonl);;"
+        "Compiled rule archive (*.rtr)";
+    const char* const kStatisticsFileFilter 
+        = "JSON (*.json);;Prometheus text format (*.prom *.txt)";
+    const int kStatisticsColumnWidth = 100;
+    const int kStatisticsUpdateIntervalMs = 1000;
+}
+
 SubstitutionEditor::SubstitutionEditor(QWidget* parent)
     : QDialog(parent)
+    , m_contextMenuSelectedItem(nullptr)
+    , m_hookStats(nullptr)
 {
     m_widgets.setupUi(this);
+    m_widgets.lblHookStats->hide();
     
     connect(m_widgets.tvSubstitutions, 
         SIGNAL(customContextMenuRequested(const QPoint&)),
@@ -126,14 +227,71 @@ SubstitutionEditor::SubstitutionEditor(QWidget* parent)
     connect(m_widgets.btnAdd, SIGNAL(clicked(bool)), SLOT(addSubstitution(bool)));
     connect(m_widgets.btnImport, SIGNAL(clicked(bool)), SLOT(importRules(bool)));
     connect(m_widgets.btnExport, SIGNAL(clicked(bool)), SLOT(exportRules(bool)));
+    connect(m_widgets.btnDumpStatistics, SIGNAL(clicked(bool)), SLOT(dumpStatistics(bool)));
 
     m_widgets.tvSubstitutions->setContextMenuPolicy(Qt::CustomContextMenu);
+
+    // The statistics keep changing while the dialog is open.
+    connect(&m_statisticsTimer, SIGNAL(timeout()), SLOT(updateStatistics()));
+    m_statisticsTimer.start(kStatisticsUpdateIntervalMs);
 }
 
 void SubstitutionEditor::setModel(SubstitutionModel* model)
 {
     assert(model);
     m_widgets.tvSubstitutions->setModel(model);
+    for (int column = kColumnEvaluations; column < kColumnCount; ++column)
+        m_widgets.tvSubstitutions->setColumnWidth(column, kStatisticsColumnWidth);
+}
+
+void SubstitutionEditor::setHookStats(const HookStats* hookStats)
+{
+    m_hookStats = hookStats;
+    m_widgets.lblHookStats->setVisible(hookStats != nullptr);
+    updateStatistics();
+}
+
+void SubstitutionEditor::updateStatistics()
+{
+    if (model())
+        model()->updateStatistics();
+    if (!m_hookStats)
+        return;
+
+    auto text = QString("Hook: %1 calls").arg(static_cast<qulonglong>(m_hookStats->calls.count()));
+    if (StatisticsSampler::rate())
+    {
+        text += QString(" taking %1, of which demangling %2 and substitution %3 "
+            "(timing 1 in %4)")
+            .arg(formatDuration(m_hookStats->calls.estimatedNs()))
+            .arg(formatDuration(m_hookStats->demangler.estimatedNs()))
+            .arg(formatDuration(m_hookStats->substitution.estimatedNs()))
+            .arg(StatisticsSampler::rate());
+    }
+    m_widgets.lblHookStats->setText(text);
+}
+
+void SubstitutionEditor::dumpStatistics(bool)
+{
+    auto fileName = QFileDialog::getSaveFileName(qApp->activeWindow(), "Dump statistics...", 
+        QString(), kStatisticsFileFilter);
+
+    if (fileName.isEmpty())
+        return;
+
+    try
+    {
+        StatisticsExporter exporter(model()->substitutionManager(), m_hookStats);
+        if (fileName.endsWith(".json", Qt::CaseInsensitive))
+            exporter.exportJson(fileName);
+        else
+            exporter.exportPrometheus(fileName);
+    }
+    catch (const StatisticsExporter::Error& e)
+    {
+        QMessageBox::warning(qApp->activeWindow(), PLUGIN_NAME, 
+            QString("Cannot dump statistics: ") + e.what());
+    }
 }
 
 SubstitutionModel* SubstitutionEditor::model()
@@ -172,23 +330,33 @@ void SubstitutionEditor::addSubstitution(bool)
 
     // Valid?
     auto newSubst = std::make_shared<Substitution>();
+    newSubst->mode = static_cast<Substitution::Mode>(m_widgets.cbMode->currentIndex());
     try
     {
-        newSubst->regexp = std::regex(regexp, std::regex_constants::optimize);
+        newSubst->matcher = model()->substitutionManager()->compilePattern(regexp, 
+            newSubst->mode);
     }
-    catch (const std::regex_error& e)
+    catch (const Matcher::Error& e)
     {
         QMessageBox::warning(qApp->activeWindow(), PLUGIN_NAME,
-            QString("The given regexp does not seem to be valid:\n") + e.what());
+            QString("The given pattern does not seem to be valid:\n") + e.what());
         return;
     }
     
     newSubst->replacement = m_widgets.leReplacement->text().toStdString();
     newSubst->regexpPattern = regexp;
+    const auto guards = m_widgets.leGuards->text().split(',', QString::SkipEmptyParts);
+    for (auto it = guards.cbegin(), end = guards.cend(); it != end; ++it)
+    {
+        if (!it->trimmed().isEmpty())
+            newSubst->declaredGuards.push_back(it->trimmed().toStdString());
+    }
 
     // Sane, add to list.
     m_widgets.leSearchText->clear();
     m_widgets.leReplacement->clear();
+    m_widgets.leGuards->clear();
+    m_widgets.cbMode->setCurrentIndex(Substitution::kModeMatch);
     model()->substitutionManager()->addRule(std::move(newSubst));
     model()->update();
 }
@@ -233,14 +401,49 @@ void SubstitutionEditor::deleteSubstitution(bool)
 void SubstitutionEditor::importRules(bool)
 {
     auto fileName = QFileDialog::getOpenFileName(qApp->activeWindow(), "Import rules...", 
-        QString(), "Rule file (*.ini)");
+        QString(), kRuleFileFilter);
 
     if (fileName.isEmpty())
         return;
 
-    QSettings settings(fileName, QSettings::IniFormat);
-    SettingsImporterExporter importer(model()->substitutionManager(), &settings);
-    importer.importRules();
+    if (fileName.endsWith(".rtr", Qt::CaseInsensitive))
+    {
+        try
+        {
+            ArchiveImporterExporter importer(model()->substitutionManager(), fileName);
+            importer.importRules();
+        }
+        catch (const ArchiveImporterExporter::Error& e)
+        {
+            QMessageBox::warning(qApp->activeWindow(), PLUGIN_NAME, 
+                QString("Cannot import rules: ") + e.what());
+        }
+    }
+    else if (fileName.endsWith(".jsonl", Qt::CaseInsensitive))
+    {
+        try
+        {
+            JsonLinesImporterExporter importer(model()->substitutionManager(), fileName);
+            const auto skipped = importer.importRules();
+            if (skipped)
+            {
+                QMessageBox::warning(qApp->activeWindow(), PLUGIN_NAME, 
+                    QString::number(skipped) + " line(s) could not be imported, "
+                    "see the output window for details.");
+            }
+        }
+        catch (const JsonLinesImporterExporter::Error& e)
+        {
+            QMessageBox::warning(qApp->activeWindow(), PLUGIN_NAME, 
+                QString("Cannot import rules: ") + e.what());
+        }
+    }
+    else
+    {
+        QSettings settings(fileName, QSettings::IniFormat);
+        SettingsImporterExporter importer(model()->substitutionManager(), &settings);
+        importer.importRules();
+    }
 
     model()->update();
 }
@@ -248,14 +451,43 @@ void SubstitutionEditor::importRules(bool)
 void SubstitutionEditor::exportRules(bool)
 {
     auto fileName = QFileDialog::getSaveFileName(qApp->activeWindow(), "Export rules...", 
-        QString(), "Rule file (*.ini)");
+        QString(), kRuleFileFilter);
 
     if (fileName.isEmpty())
         return;
 
-    QSettings settings(fileName, QSettings::IniFormat);
-    SettingsImporterExporter exporter(model()->substitutionManager(), &settings);
-    exporter.exportRules();
+    if (fileName.endsWith(".rtr", Qt::CaseInsensitive))
+    {
+        try
+        {
+            ArchiveImporterExporter exporter(model()->substitutionManager(), fileName);
+            exporter.exportRules();
+        }
+        catch (const ArchiveImporterExporter::Error& e)
+        {
+            QMessageBox::warning(qApp->activeWindow(), PLUGIN_NAME, 
+                QString("Cannot export rules: ") + e.what());
+        }
+    }
+    else if (fileName.endsWith(".jsonl", Qt::CaseInsensitive))
+    {
+        try
+        {
+            JsonLinesImporterExporter exporter(model()->substitutionManager(), fileName);
+            exporter.exportRules();
+        }
+        catch (const JsonLinesImporterExporter::Error& e)
+        {
+            QMessageBox::warning(qApp->activeWindow(), PLUGIN_NAME, 
+                QString("Cannot export rules: ") + e.what());
+        }
+    }
+    else
+    {
+        QSettings settings(fileName, QSettings::IniFormat);
+        SettingsImporterExporter exporter(model()->substitutionManager(), &settings);
+        exporter.exportRules();
+    }
 }
 
 void SubstitutionEditor::editSubstitution(bool)
@@ -267,6 +499,12 @@ void SubstitutionEditor::editSubstitution(bool)
         m_contextMenuSelectedItem->regexpPattern));
     m_widgets.leReplacement->setText(QString::fromStdString(
         m_contextMenuSelectedItem->replacement));
+    m_widgets.cbMode->setCurrentIndex(m_contextMenuSelectedItem->mode);
+    QStringList guards;
+    const auto& declaredGuards = m_contextMenuSelectedItem->declaredGuards;
+    for (auto it = declaredGuards.cbegin(), end = declaredGuards.cend(); it != end; ++it)
+        guards << QString::fromStdString(*it);
+    m_widgets.leGuards->setText(guards.join(", "));
     model()->substitutionManager()->removeRule(m_contextMenuSelectedItem);
     m_contextMenuSelectedItem = nullptr;
     model()->update();
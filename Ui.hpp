@@ -28,9 +28,11 @@
 #include "ui_SubstitutionEditor.h"
 #include "ui_AboutDialog.h"
 #include "SubstitutionManager.hpp"
+#include "Statistics.hpp"
 
 #include <QDialog>
 #include <QAbstractListModel>
+#include <QTimer>
 
 // ============================================================================================== //
 // [SubstitutionModel]                                                                            //
@@ -54,6 +56,10 @@ public: // Implementation of QAbstractItemModel interface.
 public: // Public interface.
     const Substitution* substitutionByIndex(const QModelIndex& index);
     void update();
+    /**
+     * @brief   Makes the views fetch the statistics columns again.
+     */
+    void updateStatistics();
 public: // Accessors.
     SubstitutionManager* substitutionManager() { return m_substMgr; }
 };
@@ -68,12 +74,18 @@ class SubstitutionEditor : public QDialog
 
     Ui::SubstitutionEditor m_widgets;
     const Substitution* m_contextMenuSelectedItem;
+    const HookStats* m_hookStats;
+    QTimer m_statisticsTimer;
 public:
     explicit SubstitutionEditor(QWidget* parent=nullptr);
     virtual ~SubstitutionEditor() {}
 public:
     void setModel(SubstitutionModel* model);
     SubstitutionModel* model();
+    /**
+     * @brief   Shows the hook totals along with the rules' statistics.
+     */
+    void setHookStats(const HookStats* hookStats);
 protected slots:
     void addSubstitution(bool); // any idea how ofen I wrote "substitution" today? goddamit.
     void displayContextMenu(const QPoint& point);
@@ -81,6 +93,8 @@ protected slots:
     void editSubstitution(bool);
     void importRules(bool);
     void exportRules(bool);
+    void dumpStatistics(bool);
+    void updateStatistics();
 };
 
 // ============================================================================================== //
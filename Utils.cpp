@@ -24,7 +24,135 @@
 
 #include "Utils.hpp"
 
+#include <QFile>
+#include <QFileInfo>
+#include <cstdio>
+#ifdef _WIN32
+#   include <Windows.h>
+#else
+#   include <cerrno>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
 namespace Utils
 {
 
+// ============================================================================================== //
+// [Files]                                                                                        //
+// ============================================================================================== //
+
+#ifdef _WIN32
+
+bool writeFileAtomically(const QString& path, const char* data, size_t size)
+{
+    const QString tempPath = path + ".tmp";
+    const auto tempPathW = reinterpret_cast<const wchar_t*>(tempPath.utf16());
+    const HANDLE temp = ::CreateFileW(tempPathW, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (temp == INVALID_HANDLE_VALUE)
+        return false;
+
+    // The contents have to be on disk before the rename is, or a crash in between may leave 
+    // a renamed but empty file behind.
+    const DWORD kMaxChunk = 1u << 30;
+    bool written = true;
+    for (size_t offset = 0; written && offset < size;)
+    {
+        const DWORD chunk = size - offset > kMaxChunk 
+            ? kMaxChunk : static_cast<DWORD>(size - offset);
+        DWORD chunkWritten = 0;
+        written = ::WriteFile(temp, data + offset, chunk, &chunkWritten, nullptr) != FALSE
+            && chunkWritten == chunk;
+        offset += chunkWritten;
+    }
+    written = written && ::FlushFileBuffers(temp) != FALSE;
+    ::CloseHandle(temp);
+
+    if (!written || !::MoveFileExW(tempPathW, reinterpret_cast<const wchar_t*>(path.utf16()), 
+            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        ::DeleteFileW(tempPathW);
+        return false;
+    }
+    return true;
+}
+
+#else
+
+bool writeFileAtomically(const QString& path, const char* data, size_t size)
+{
+    const QByteArray nativePath = QFile::encodeName(path);
+    const QByteArray tempPath = nativePath + ".tmp";
+    const int temp = ::open(tempPath.constData(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (temp < 0)
+        return false;
+
+    // The contents have to be on disk before the rename is, or a crash in between may leave 
+    // a renamed but empty file behind.
+    bool written = true;
+    for (size_t offset = 0; written && offset < size;)
+    {
+        const ssize_t chunk = ::write(temp, data + offset, size - offset);
+        if (chunk < 0 && errno == EINTR)
+            continue;
+        written = chunk > 0;
+        offset += written ? static_cast<size_t>(chunk) : 0;
+    }
+    written = written && ::fsync(temp) == 0;
+    written = ::close(temp) == 0 && written;
+
+    if (!written || std::rename(tempPath.constData(), nativePath.constData()) != 0)
+    {
+        ::unlink(tempPath.constData());
+        return false;
+    }
+
+    // Makes the rename itself durable. Not all file systems support syncing a directory, the 
+    // file is replaced either way, so failures are ignored.
+    const QByteArray directory = QFile::encodeName(QFileInfo(path).absolutePath());
+    const int directoryFd = ::open(directory.constData(), O_RDONLY);
+    if (directoryFd >= 0)
+    {
+        ::fsync(directoryFd);
+        ::close(directoryFd);
+    }
+    return true;
+}
+
+#endif // _WIN32
+
+// ============================================================================================== //
+// [JSON]                                                                                         //
+// ============================================================================================== //
+
+void appendJsonString(std::string& out, const std::string& value)
+{
+    out += '"';
+    for (auto it = value.cbegin(), end = value.cend(); it != end; ++it)
+    {
+        const auto c = static_cast<unsigned char>(*it);
+        switch (c)
+        {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n";  break;
+            case '\r': out += "\\r";  break;
+            case '\t': out += "\\t";  break;
+            default:
+                if (c < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                }
+                else
+                    out += *it;
+        }
+    }
+    out += '"';
+}
+
+// ============================================================================================== //
+
 }
\ No newline at end of file
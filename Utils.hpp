@@ -27,6 +27,14 @@
 
 #include <QString>
 #include <QDir>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
 
 namespace Utils
 {
@@ -94,6 +102,169 @@ bool Singleton<T>::isInstantiated()
     return m_instance != nullptr;
 }
 
+// ============================================================================================== //
+// [Files]                                                                                        //
+// ============================================================================================== //
+
+/**
+ * @brief   Writes a file by renaming a temporary file over it, so readers see either the old
+ *          or the new contents in full.
+ *
+ * The temporary file is flushed to disk before it replaces the old file in a single rename
+ * (@c MoveFileExW on Windows, @c rename(2) elsewhere), so a crash at any point leaves either
+ * file intact.
+ * @return  @c false if the file could not be written.
+ */
+bool writeFileAtomically(const QString& path, const char* data, size_t size);
+
+// ============================================================================================== //
+// [JSON]                                                                                         //
+// ============================================================================================== //
+
+/**
+ * @brief   Appends a string as a quoted JSON string. Bytes outside ASCII are passed through,
+ *          so UTF-8 stays UTF-8.
+ */
+void appendJsonString(std::string& out, const std::string& value);
+
+// ============================================================================================== //
+// [Hashing]                                                                                      //
+// ============================================================================================== //
+
+const uint64_t kFnvOffsetBasis = 0xCBF29CE484222325ULL;
+
+/**
+ * @brief   64 bit FNV-1a hash. Unlike @c std::hash, the result is stable across builds and
+ *          may be persisted. Pass a previous result as @c hash to hash several pieces.
+ */
+inline uint64_t fnv1a(const void* data, size_t length, uint64_t hash = kFnvOffsetBasis)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+/**
+ * @brief   Hash for in-memory tables, several times faster than fnv1a on long keys as it
+ *          consumes eight bytes per step. Depends on the byte order, don't persist it.
+ */
+inline uint64_t hashBytes(const void* data, size_t length)
+{
+    const uint64_t kMultiplier = 0xFF51AFD7ED558CCDULL;
+    auto bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = length * 0x9E3779B97F4A7C15ULL;
+    for (; length >= 8; bytes += 8, length -= 8)
+    {
+        uint64_t word;
+        ::memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * kMultiplier;
+        hash ^= hash >> 32;
+    }
+    uint64_t tail = 0;
+    ::memcpy(&tail, bytes, length);
+    hash = (hash ^ tail) * kMultiplier;
+    return hash ^ (hash >> 29);
+}
+
+// ============================================================================================== //
+// [RcuPointer]                                                                                   //
+// ============================================================================================== //
+
+/**
+ * @brief   Publishes immutable objects to concurrent readers, RCU style.
+ *
+ * Readers take no lock: they register in one of two counters selected by the current epoch
+ * and load the pointer. Writers are serialized, swap in the new object, then flip the epoch
+ * and wait for each counter to drain before deleting the old object. Readers entering after
+ * a flip use the other counter, so a steady stream of readers cannot starve a writer.
+ */
+template<typename T>
+class RcuPointer : public NonCopyable
+{
+    std::atomic<T*> m_current;
+    std::atomic<unsigned> m_epoch;
+    std::atomic<unsigned> m_readers[2];
+    std::mutex m_writerMutex;
+public:
+    /**
+     * @brief   RAII read-side critical section. The object stays alive while it exists.
+     */
+    class ReadGuard : public NonCopyable
+    {
+        RcuPointer* m_owner;
+        unsigned m_slot;
+        const T* m_object;
+    public:
+        explicit ReadGuard(const RcuPointer& owner);
+        ~ReadGuard();
+    public:
+        const T* get() const { return m_object; }
+        const T& operator * () const { return *m_object; }
+        const T* operator -> () const { return m_object; }
+    };
+public:
+    explicit RcuPointer(std::unique_ptr<T> initial = nullptr);
+    ~RcuPointer();
+public:
+    /**
+     * @brief   Publishes a new object and deletes the previous one once no reader uses it.
+     *          Blocks until then, so this must not be called from within a ReadGuard.
+     */
+    void update(std::unique_ptr<T> next);
+};
+
+// ============================================================================================== //
+// Implementation of inline methods [RcuPointer]                                                  //
+// ============================================================================================== //
+
+template<typename T> inline
+RcuPointer<T>::ReadGuard::ReadGuard(const RcuPointer& owner)
+    : m_owner(const_cast<RcuPointer*>(&owner))
+    , m_slot(m_owner->m_epoch.load() & 1)
+{
+    // The counter is incremented before the pointer is loaded. A writer either sees this
+    // reader in the counter or the reader sees the writer's new object.
+    ++m_owner->m_readers[m_slot];
+    m_object = m_owner->m_current.load();
+}
+
+template<typename T> inline
+RcuPointer<T>::ReadGuard::~ReadGuard()
+{
+    --m_owner->m_readers[m_slot];
+}
+
+template<typename T> inline
+RcuPointer<T>::RcuPointer(std::unique_ptr<T> initial)
+    : m_current(initial.release())
+    , m_epoch(0)
+{
+    m_readers[0] = 0;
+    m_readers[1] = 0;
+}
+
+template<typename T> inline
+RcuPointer<T>::~RcuPointer()
+{
+    delete m_current.load();
+}
+
+template<typename T> inline
+void RcuPointer<T>::update(std::unique_ptr<T> next)
+{
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    std::unique_ptr<T> previous(m_current.exchange(next.release()));
+
+    // Readers that might hold the previous object are registered in either counter.
+    for (int phase = 0; phase < 2; ++phase)
+    {
+        const auto slot = m_epoch++ & 1;
+        while (m_readers[slot].load() != 0)
+            std::this_thread::yield();
+    }
+}
+
 // ============================================================================================== //
 
 }
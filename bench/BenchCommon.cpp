@@ -0,0 +1,214 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "BenchCommon.hpp"
+
+#include "SubstitutionManager.hpp"
+#include "ImportExport.hpp"
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <QSettings>
+
+// ============================================================================================== //
+// [Allocation counting]                                                                          //
+// ============================================================================================== //
+
+namespace
+{
+    std::atomic<uint64_t> g_allocationCount(0);
+}
+
+void* operator new(std::size_t size)
+{
+    ++g_allocationCount;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) throw()
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+    std::free(ptr);
+}
+
+namespace Bench
+{
+
+uint64_t allocationCount()
+{
+    return g_allocationCount;
+}
+
+// ============================================================================================== //
+// [Input]                                                                                        //
+// ============================================================================================== //
+
+std::vector<std::string> loadLines(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+        throw std::runtime_error("cannot open " + path);
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        if (!line.empty())
+            lines.push_back(line);
+    }
+    return lines;
+}
+
+void loadRules(SubstitutionManager& manager, const std::string& path)
+{
+    QSettings settings(QString::fromStdString(path), QSettings::IniFormat);
+    SettingsImporterExporter importer(&manager, &settings);
+    importer.importRules();
+}
+
+void addSyntheticRules(SubstitutionManager& manager, unsigned count)
+{
+    static const char* const kTypes[] = 
+    {
+        "int", "unsigned int", "char", "short", "float", "double", "bool", "void \\*", 
+        "__int64", "unsigned char",
+    };
+    static const char* const kContainers[] = { "vector", "list", "deque", "set" };
+
+    SubstitutionManager::Transaction transaction(manager);
+    char pattern[512], replacement[128];
+    for (unsigned i = 0; i < count; ++i)
+    {
+        // Roughly one in ten rules targets STL types, the rest vendor libraries.
+        if (i % 10 == 0)
+        {
+            const char* type = kTypes[(i / 10) % (sizeof(kTypes) / sizeof(*kTypes))];
+            const char* container 
+                = kContainers[(i / 100) % (sizeof(kContainers) / sizeof(*kContainers))];
+            std::snprintf(pattern, sizeof(pattern), 
+                "(.*)std::%s<%s,\\s*(?:class\\s+)?std::allocator<%s\\s*>\\s*>(.*)", 
+                container, type, type);
+            std::snprintf(replacement, sizeof(replacement), "$1std::%s<%s>$2", 
+                container, type);
+        }
+        else
+        {
+            std::snprintf(pattern, sizeof(pattern), 
+                "(.*)vendor%u::detail::Container%u<(.*),\\s*vendor%u::Allocator%u\\s*>(.*)", 
+                i % 37, i, i % 37, i);
+            std::snprintf(replacement, sizeof(replacement), "$1Container%u<$2>$3", i);
+        }
+
+        auto subst = std::make_shared<Substitution>();
+        subst->regexpPattern = pattern;
+        subst->replacement = replacement;
+        subst->matcher = manager.compilePattern(subst->regexpPattern);
+        manager.addRule(std::move(subst));
+    }
+}
+
+// ============================================================================================== //
+// [Statistics]                                                                                   //
+// ============================================================================================== //
+
+LatencyStats summarize(std::vector<uint64_t>& samples)
+{
+    LatencyStats stats = { 0., 0., 0, 0, 0 };
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+    const double total = static_cast<double>(
+        std::accumulate(samples.cbegin(), samples.cend(), uint64_t(0)));
+    stats.meanNs = total / samples.size();
+    stats.namesPerSecond = total > 0. ? samples.size() * 1e9 / total : 0.;
+    stats.p50Ns = samples[samples.size() / 2];
+    stats.p99Ns = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    stats.maxNs = samples.back();
+    return stats;
+}
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// ============================================================================================== //
+// [Options]                                                                                      //
+// ============================================================================================== //
+
+Options::Options(int argc, char** argv)
+    : m_args(argv + 1, argv + argc)
+{
+    
+}
+
+std::string Options::value(const std::string& name, const std::string& defaultValue) const
+{
+    auto it = std::find(m_args.cbegin(), m_args.cend(), "--" + name);
+    if (it == m_args.cend() || it + 1 == m_args.cend())
+        return defaultValue;
+    return *(it + 1);
+}
+
+unsigned Options::number(const std::string& name, unsigned defaultValue) const
+{
+    auto text = value(name, std::string());
+    return text.empty() ? defaultValue : static_cast<unsigned>(std::strtoul(text.c_str(), 
+        nullptr, 10));
+}
+
+RegexBackend::Kind Options::backend() const
+{
+    auto kind = RegexBackend::fromName(value("backend", "std"));
+    if (!RegexBackend::isAvailable(kind))
+        throw std::runtime_error(std::string("backend not available: ") 
+            + RegexBackend::name(kind));
+    return kind;
+}
+
+// ============================================================================================== //
+
+}
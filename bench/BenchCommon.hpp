@@ -0,0 +1,109 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BENCHCOMMON_HPP
+#define BENCHCOMMON_HPP
+
+#include "RegexBackend.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class SubstitutionManager;
+
+namespace Bench
+{
+
+// ============================================================================================== //
+// [Allocation counting]                                                                          //
+// ============================================================================================== //
+
+/**
+ * @brief   Returns the number of global operator new calls made by this process so far.
+ */
+uint64_t allocationCount();
+
+// ============================================================================================== //
+// [Input]                                                                                        //
+// ============================================================================================== //
+
+/**
+ * @brief   Reads the non-empty lines of a text file.
+ * @throws  std::runtime_error  If the file cannot be read.
+ */
+std::vector<std::string> loadLines(const std::string& path);
+/**
+ * @brief   Imports the rules of a rule file in QSettings INI format.
+ */
+void loadRules(SubstitutionManager& manager, const std::string& path);
+/**
+ * @brief   Adds a synthetic rule pack resembling a large team rule library.
+ */
+void addSyntheticRules(SubstitutionManager& manager, unsigned count);
+
+// ============================================================================================== //
+// [Statistics]                                                                                   //
+// ============================================================================================== //
+
+struct LatencyStats
+{
+    double meanNs;
+    double namesPerSecond;
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t maxNs;
+};
+
+/**
+ * @brief   Summarizes per-call latencies. Sorts @c samples.
+ */
+LatencyStats summarize(std::vector<uint64_t>& samples);
+/**
+ * @brief   Returns a monotonic timestamp in nanoseconds.
+ */
+uint64_t nowNs();
+
+// ============================================================================================== //
+// [Options]                                                                                      //
+// ============================================================================================== //
+
+/**
+ * @brief   Tiny "--name value" command line parser.
+ */
+class Options
+{
+    std::vector<std::string> m_args;
+public:
+    Options(int argc, char** argv);
+    std::string value(const std::string& name, const std::string& defaultValue) const;
+    unsigned number(const std::string& name, unsigned defaultValue) const;
+    RegexBackend::Kind backend() const;
+};
+
+// ============================================================================================== //
+
+}
+
+#endif // BENCHCOMMON_HPP
@@ -0,0 +1,253 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file    Soundness check of carrying the result cache over rule changes.
+ *
+ * Fills a result cache with the corpus, then changes the rules in a number of ways: adding 
+ * rules that match nothing, adding and removing rules that do, and random transactions 
+ * drawn from the rule file and a synthetic rule pack. After every change the cache is carried 
+ * over by a CacheInvalidator and every entry it kept is compared with a fresh substitution 
+ * under the new rules. Any difference is a stale result the views would keep showing.
+ *
+ * Usage: retypedef_invalidation_check [--corpus FILE] [--rules FILE] [--transactions N] 
+ *                                     [--seed N] [--elide 0|1]
+ */
+
+#include "BenchCommon.hpp"
+
+#include "SubstitutionManager.hpp"
+#include "ResultCache.hpp"
+#include "CacheInvalidator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const uint32_t kBufferSize = 4096;
+
+void load(char* buffer, const std::string& name)
+{
+    auto length = std::min<size_t>(name.size(), kBufferSize - 1);
+    ::memcpy(buffer, name.data(), length);
+    buffer[length] = '\0';
+}
+
+class Checker
+{
+    SubstitutionManager& m_manager;
+    const std::vector<std::string>& m_names;
+    ResultCache m_cache;
+    CacheInvalidator m_invalidator;
+    unsigned m_refreshes;
+    size_t m_stale;
+public:
+    Checker(SubstitutionManager& manager, const std::vector<std::string>& names)
+        : m_manager(manager)
+        , m_names(names)
+        , m_cache(~size_t(0))
+        , m_invalidator(m_cache, [this] { ++m_refreshes; })
+        , m_refreshes(0)
+        , m_stale(0)
+    {
+        SubstitutionManager::Snapshot ruleSet(m_manager.ruleSet());
+        m_invalidator.reset(*ruleSet);
+        fill();
+    }
+
+    ResultCache& cache() { return m_cache; }
+    CacheInvalidator& invalidator() { return m_invalidator; }
+    size_t stale() const { return m_stale; }
+    unsigned refreshes() const { return m_refreshes; }
+
+    /**
+     * @brief   Carries the cache over to the current rules and verifies the entries kept.
+     * @param   what    Describes the change for the report, or @c nullptr to stay quiet.
+     */
+    void rulesChanged(const char* what)
+    {
+        SubstitutionManager::Snapshot ruleSet(m_manager.ruleSet());
+        const auto start = Bench::nowNs();
+        const bool refreshed = m_invalidator.rulesChanged(*ruleSet);
+        const auto elapsed = Bench::nowNs() - start;
+
+        size_t kept = 0;
+        const auto stale = verify(*ruleSet, kept);
+        m_stale += stale;
+        if (what)
+        {
+            std::printf("%-32s refresh %d  kept %6zu/%zu  stale %zu  %8.2f ms\n", what, 
+                refreshed, kept, m_names.size(), stale, elapsed / 1e6);
+        }
+        fill();
+    }
+
+    /**
+     * @brief   Demangles the names missing from the cache, like the hook would.
+     */
+    void fill()
+    {
+        SubstitutionManager::Snapshot ruleSet(m_manager.ruleSet());
+        char buffer[kBufferSize];
+        int32_t ret;
+        RewriteTrace trace;
+        for (auto it = m_names.cbegin(), end = m_names.cend(); it != end; ++it)
+        {
+            const char* name = it->c_str();
+            if (m_cache.lookup(name, 0, ruleSet->generation(), buffer, sizeof(buffer), ret))
+                continue;
+            load(buffer, *it);
+            trace.clear();
+            m_manager.applyToString(*ruleSet, buffer, sizeof(buffer), nullptr, &trace);
+            m_cache.insert(name, 0, ruleSet->generation(), 0, buffer, sizeof(buffer), trace);
+        }
+    }
+protected:
+    size_t verify(const RuleSet& ruleSet, size_t& kept)
+    {
+        char cached[kBufferSize], fresh[kBufferSize];
+        int32_t ret;
+        size_t stale = 0;
+        for (auto it = m_names.cbegin(), end = m_names.cend(); it != end; ++it)
+        {
+            const char* name = it->c_str();
+            if (!m_cache.lookup(name, 0, ruleSet.generation(), cached, sizeof(cached), ret))
+                continue;
+            ++kept;
+            load(fresh, *it);
+            m_manager.applyToString(ruleSet, fresh, sizeof(fresh));
+            if (std::strcmp(cached, fresh) && ++stale <= 3)
+                std::printf("STALE %s\n  cached %s\n  fresh  %s\n", name, cached, fresh);
+        }
+        return stale;
+    }
+};
+
+std::shared_ptr<Substitution> makeRule(SubstitutionManager& manager, const std::string& pattern,
+    const std::string& replacement)
+{
+    auto subst = std::make_shared<Substitution>();
+    subst->regexpPattern = pattern;
+    subst->replacement = replacement;
+    subst->matcher = manager.compilePattern(subst->regexpPattern);
+    return subst;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        Bench::Options options(argc, argv);
+        const auto corpusPath = options.value("corpus", 
+            RETYPEDEF_SOURCE_DIR "/bench/corpus/msvc_demangled.txt");
+        const auto rulesPath = options.value("rules", 
+            RETYPEDEF_SOURCE_DIR "/resources/default_rules.ini");
+        const auto transactions = options.number("transactions", 200);
+        const auto seed = options.number("seed", 7);
+        const bool elide = options.number("elide", 1) != 0;
+
+        const auto names = Bench::loadLines(corpusPath);
+
+        SubstitutionManager manager;
+        manager.setRewriteBudget(100000, 100000);
+        manager.setElideDefaultArguments(elide);
+        Bench::loadRules(manager, rulesPath);
+
+        // Rules the random transactions add.
+        SubstitutionManager pool;
+        Bench::loadRules(pool, rulesPath);
+        Bench::addSyntheticRules(pool, 100);
+
+        Checker checker(manager, names);
+        auto addRule = [&](const std::string& pattern, const std::string& replacement)
+        {
+            manager.addRule(makeRule(manager, pattern, replacement));
+        };
+
+        addRule("FooBarQux", "x");
+        checker.rulesChanged("add unrelated");
+        addRule("(.*)std::vector<(.*)>(.*)", "$1vec<$2>$3");
+        checker.rulesChanged("add vector rule");
+        manager.removeRule(manager.rules().back().get());
+        checker.rulesChanged("remove vector rule");
+        if (!manager.rules().empty())
+        {
+            manager.removeRule(manager.rules().front().get());
+            checker.rulesChanged("remove first rule");
+        }
+
+        std::mt19937 random(seed);
+        const auto& poolRules = pool.rules();
+        for (unsigned i = 0; i < transactions; ++i)
+        {
+            {
+                SubstitutionManager::Transaction transaction(manager);
+                const auto changes = random() % 3 + 1;
+                for (unsigned j = 0; j < changes; ++j)
+                {
+                    const auto& rules = manager.rules();
+                    if (random() % 2 && rules.size() > 2)
+                        manager.removeRule(rules[random() % rules.size()].get());
+                    else
+                    {
+                        const auto& source = poolRules[random() % poolRules.size()];
+                        addRule(source->regexpPattern, source->replacement);
+                    }
+                }
+            }
+            checker.rulesChanged(nullptr);
+        }
+        std::printf("%-32s stale %zu so far\n", "random transactions", checker.stale());
+
+        checker.invalidator().untrackedResult();
+        addRule("FooBarQux2", "x");
+        checker.rulesChanged("untracked result, add unrelated");
+        addRule("FooBarQux3", "x");
+        checker.rulesChanged("add unrelated again");
+
+        checker.cache().setMemoryLimit(checker.cache().memoryUsage() / 2);
+        checker.fill();
+        addRule("FooBarQux4", "x");
+        checker.rulesChanged("evictions, add unrelated");
+
+        std::printf("%zu names, %u refreshes, %zu evictions, %zu stale\n", names.size(),
+            checker.refreshes(), checker.cache().evictions(), checker.stale());
+        return checker.stale() ? 1 : 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+}
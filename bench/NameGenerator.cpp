@@ -0,0 +1,86 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "NameGenerator.hpp"
+
+namespace Bench
+{
+
+// ============================================================================================== //
+// [NameGenerator]                                                                                //
+// ============================================================================================== //
+
+NameGenerator::NameGenerator(unsigned maxDepth, bool wide)
+    : m_maxDepth(maxDepth)
+    , m_wide(wide)
+{
+    
+}
+
+std::string NameGenerator::nestedType(unsigned depth) const
+{
+    const std::string ch = m_wide ? "wchar_t" : "char";
+    const std::string str = "class std::basic_string<" + ch + ", struct std::char_traits<" 
+        + ch + ">, class std::allocator<" + ch + ">>";
+    if (depth == 0)
+        return str;
+
+    // Alternate between maps and pairs keyed by strings, the nested type appears only once per
+    // level so the length grows linearly with the depth.
+    const auto inner = nestedType(depth - 1);
+    if (depth % 2)
+        return "class std::map<" + str + ", " + inner + ", struct std::less<" + str + ">>";
+    return "struct std::pair<" + str + " const, " + inner + ">";
+}
+
+std::string NameGenerator::generate(size_t length, unsigned& depth) const
+{
+    static const char kPrefix[] = "public: void __thiscall Container::insert(";
+    static const char kSuffix[] = ")";
+    const size_t overhead = sizeof(kPrefix) - 1 + sizeof(kSuffix) - 1;
+
+    // Pick the deepest type that still fits into a single parameter.
+    depth = 0;
+    auto type = nestedType(0);
+    while (depth < m_maxDepth)
+    {
+        auto deeper = nestedType(depth + 1);
+        if (deeper.size() + overhead > length)
+            break;
+        type.swap(deeper);
+        ++depth;
+    }
+
+    std::string name = kPrefix;
+    name.reserve(length + type.size() + overhead);
+    name += type;
+    while (name.size() + sizeof(kSuffix) - 1 < length)
+        name += ", " + type;
+    name += kSuffix;
+    return name;
+}
+
+// ============================================================================================== //
+
+}
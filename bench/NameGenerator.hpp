@@ -0,0 +1,71 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef NAMEGENERATOR_HPP
+#define NAMEGENERATOR_HPP
+
+#include <string>
+
+namespace Bench
+{
+
+// ============================================================================================== //
+// [NameGenerator]                                                                                //
+// ============================================================================================== //
+
+/**
+ * @brief   Produces synthetic demangled names of deeply nested STL types.
+ *
+ * The names are shaped like MSVC output (elaborated type specifiers, spelled-out default
+ * template arguments) and are meant to provoke worst-case behavior of the default rules.
+ */
+class NameGenerator
+{
+    unsigned m_maxDepth;
+    bool m_wide;
+public:
+    /**
+     * @brief   Constructor.
+     * @param   maxDepth    Maximum template nesting depth of a single parameter type.
+     * @param   wide        Use @c wchar_t instead of @c char strings.
+     */
+    explicit NameGenerator(unsigned maxDepth, bool wide=false);
+public:
+    /**
+     * @brief   Returns the nested type of a given depth.
+     */
+    std::string nestedType(unsigned depth) const;
+    /**
+     * @brief   Generates a member function name of at least @c length bytes.
+     * @param   length  The minimum length.
+     * @param   depth   Receives the nesting depth of the parameter types used.
+     */
+    std::string generate(size_t length, unsigned& depth) const;
+};
+
+// ============================================================================================== //
+
+}
+
+#endif // NAMEGENERATOR_HPP
@@ -0,0 +1,170 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/**
+ * @file    Soundness check of the pattern analysis the prefilter and the mangled guards use.
+ *
+ * Every case pairs a pattern with a name it matches. The literals the analysis requires must
+ * all occur in that name, and one of the derived guards in its mangled form, or the rule
+ * would be skipped for a name it applies to. Each case is also matched with every available
+ * backend it is meant for that accepts the pattern, so the table itself stays honest.
+ *
+ * Usage: retypedef_pattern_check
+ */
+
+#include "RegexBackend.hpp"
+#include "PatternAnalysis.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <string>
+
+namespace
+{
+
+struct Case
+{
+    const char* pattern;
+    // A demangled name the pattern matches.
+    const char* name;
+    // Its mangled form, or nullptr if guards aren't checked.
+    const char* mangled;
+    // Whether the analysis is expected to find required literals.
+    bool literals;
+    // Whether the pattern is meant for the Perl style backends only.
+    bool perl;
+};
+
+const Case kCases[] =
+{
+    // ECMAScript, as understood by all backends.
+    { "(.*)std::basic_string<char,\\s*(?:struct\\s+)?std::char_traits<char>,.*>(.*)",
+        "class std::basic_string<char,struct std::char_traits<char>,class std::allocator<char> >"
+        " __cdecl f(void)", 
+        "?f@@YA?AV?$basic_string@DU?$char_traits@D@std@@V?$allocator@D@2@@std@@XZ", true, false },
+    { "(std::vector|QList)<int>", "class QList<int> g", "?g@@3V?$QList@H@@A", true, false },
+    { "foo(bar)?baz", "foobaz", nullptr, true, false },
+    { "\\x41BC\\d{2}", "ABC12", nullptr, true, false },
+    { "(?!std::)vector", "vector", nullptr, true, false },
+    { "(?:abc|de)f", "def", nullptr, true, false },
+    { "\\(a\\)", "(a)", nullptr, true, false },
+
+    // Inline flags and other group extensions of the Perl style backends.
+    { "(?i)std::basic_string", "STD::BASIC_STRING", "?x@@3VBASIC_STRING@STD@@A", false, true },
+    { "foo(?i:bar)baz", "fooBARbaz", nullptr, false, true },
+    { "(?#comment)foo", "foo", nullptr, false, true },
+    { "(?<t>int)x", "intx", nullptr, true, true },
+    { "(?P<t>int)x", "intx", nullptr, true, true },
+
+    // Escapes with arguments of the Perl style backends.
+    { "\\p{Lu}+_ptr", "ABC_ptr", "?x@@3VABC_ptr@@A", false, true },
+    { "\\pL+_ptr", "A_ptr", nullptr, true, true },
+    { "(?<t>int)\\k<t>", "intint", nullptr, false, true },
+    { "(int)\\g{1}", "intint", nullptr, false, true },
+    { "(int)\\g1x", "intintx", nullptr, true, true },
+    { "\\x{41}BC", "ABC", nullptr, false, true },
+};
+
+bool occursIn(const PatternAnalysis::Alternatives& alternatives, const std::string& text)
+{
+    for (auto it = alternatives.cbegin(), end = alternatives.cend(); it != end; ++it)
+    {
+        if (text.find(*it) != std::string::npos)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @return  The number of failed checks.
+ */
+unsigned check(const Case& c)
+{
+    unsigned failures = 0;
+    auto fail = [&](const char* what)
+    {
+        std::printf("FAIL  %-40s %s\n", c.pattern, what);
+        ++failures;
+    };
+
+    const std::string name = c.name;
+    const RegexBackend::Kind kinds[] = 
+        { RegexBackend::kStdRegex, RegexBackend::kRe2, RegexBackend::kPcre2 };
+    for (auto it = std::begin(kinds), end = std::end(kinds); it != end; ++it)
+    {
+        if (!RegexBackend::isAvailable(*it) || (c.perl && *it == RegexBackend::kStdRegex))
+            continue;
+        std::shared_ptr<const Matcher> matcher;
+        try
+        {
+            matcher = RegexBackend::compile(*it, c.pattern);
+        }
+        catch (const Matcher::Error& /*e*/)
+        {
+            continue;
+        }
+        MatchGroups groups;
+        const char* begin = name.c_str();
+        if (!matcher->search(begin, begin + name.size(), begin, groups))
+            fail(RegexBackend::name(*it));
+    }
+
+    const auto required = PatternAnalysis::requiredLiterals(c.pattern);
+    if (required.empty() == c.literals)
+        fail(c.literals ? "no literals found" : "literals found");
+    for (auto it = required.cbegin(), end = required.cend(); it != end; ++it)
+    {
+        if (!occursIn(*it, name))
+            fail(("requires '" + it->front() + "'").c_str());
+    }
+
+    if (c.mangled)
+    {
+        const auto guards = PatternAnalysis::mangledGuards(required);
+        if (!guards.empty() && !occursIn(guards, c.mangled))
+            fail(("guard '" + guards.front() + "' rejects the mangled name").c_str());
+    }
+    return failures;
+}
+
+}
+
+int main()
+{
+    try
+    {
+        unsigned failures = 0;
+        for (auto it = std::begin(kCases), end = std::end(kCases); it != end; ++it)
+            failures += check(*it);
+        std::printf("%u cases, %u failures\n", 
+            static_cast<unsigned>(std::end(kCases) - std::begin(kCases)), failures);
+        return failures ? 1 : 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+}
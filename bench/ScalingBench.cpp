@@ -0,0 +1,270 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file    Scaling benchmark of the rules on deeply nested template names.
+ *
+ * Generates names from 100 bytes up to 64KiB with a bounded template nesting depth and times
+ * every rule of a rule file individually, both the bare match and the full substitution. The 
+ * results are written as CSV (see plot_scaling.gp) and summarized as a fitted growth exponent 
+ * per rule, so super-linear behavior shows up as a trend rather than as a single slow sample.
+ *
+ * std::regex matches recursively and needs stack proportional to the input length, so the 
+ * measurements run on a thread with a configurable stack. A rule exceeding the time budget on
+ * one length is not measured on larger ones.
+ *
+ * Usage: retypedef_scaling_bench [--rules FILE] [--backend std|re2|pcre2] [--depth N]
+ *                                [--max-length N] [--repeat N] [--budget-ms N] 
+ *                                [--stack-mb N] [--output FILE]
+ */
+
+#include "BenchCommon.hpp"
+#include "NameGenerator.hpp"
+
+#include "SubstitutionManager.hpp"
+#include "ScratchArena.hpp"
+
+#include <QThread>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+
+const size_t kLengths[] = 
+{
+    100, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536
+};
+
+struct Config
+{
+    std::string rulesPath;
+    std::string outputPath;
+    RegexBackend::Kind backend;
+    unsigned depth;
+    unsigned maxLength;
+    unsigned repeat;
+    unsigned budgetMs;
+};
+
+struct Sample
+{
+    double length;
+    double applyNs;
+};
+
+/**
+ * @brief   Times @c fn @c repeat times and returns the median in nanoseconds.
+ */
+template<typename FnT>
+uint64_t medianNs(unsigned repeat, FnT fn)
+{
+    std::vector<uint64_t> samples;
+    for (unsigned i = 0; i < repeat; ++i)
+    {
+        const auto start = Bench::nowNs();
+        fn();
+        samples.push_back(Bench::nowNs() - start);
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+/**
+ * @brief   Least squares slope of log(time) over log(length).
+ */
+double growthExponent(const std::vector<Sample>& samples)
+{
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (auto it = samples.cbegin(), end = samples.cend(); it != end; ++it)
+    {
+        const auto x = std::log(it->length);
+        const auto y = std::log(std::max(it->applyNs, 1.));
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+    const double n = static_cast<double>(samples.size());
+    const auto denominator = n * sumXX - sumX * sumX;
+    return denominator > 0 ? (n * sumXY - sumX * sumY) / denominator : 0;
+}
+
+void measureRule(FILE* out, const Config& config, unsigned index, 
+    const std::shared_ptr<Substitution>& rule, bool wide)
+{
+    // A manager holding just this rule, so the substitution cost is attributable.
+    SubstitutionManager single;
+    single.setBackend(config.backend);
+    auto copy = std::make_shared<Substitution>();
+    copy->regexpPattern = rule->regexpPattern;
+    copy->replacement = rule->replacement;
+    copy->matcher = single.compilePattern(copy->regexpPattern);
+    single.addRule(copy);
+
+    const Bench::NameGenerator generator(config.depth, wide);
+    std::vector<Sample> samples;
+    std::vector<char> buffer;
+    MatchGroups groups;
+    const char* stoppedAt = nullptr;
+    
+    for (auto it = std::begin(kLengths), end = std::end(kLengths); it != end; ++it)
+    {
+        if (*it > config.maxLength)
+            break;
+
+        unsigned depth;
+        const auto name = generator.generate(*it, depth);
+        buffer.resize(name.size() * 2 + 1);
+
+        const auto matchNs = medianNs(config.repeat, [&]
+        {
+            rule->matcher->match(name.data(), name.data() + name.size(), groups);
+        });
+        const auto applyNs = medianNs(config.repeat, [&]
+        {
+            ::memcpy(buffer.data(), name.c_str(), name.size() + 1);
+            single.applyToString(buffer.data(), static_cast<uint>(buffer.size()));
+        });
+
+        std::fprintf(out, "%u,%d,%u,%u,%llu,%llu\n", index, wide ? 1 : 0, 
+            static_cast<unsigned>(name.size()), depth, 
+            static_cast<unsigned long long>(matchNs), 
+            static_cast<unsigned long long>(applyNs));
+        Sample sample = { static_cast<double>(name.size()), static_cast<double>(applyNs) };
+        samples.push_back(sample);
+
+        if (std::max(matchNs, applyNs) > config.budgetMs * 1000000ULL)
+        {
+            stoppedAt = (it + 1 != end && *(it + 1) <= config.maxLength) ? "budget" : nullptr;
+            break;
+        }
+    }
+
+    // Short names are dominated by constant overhead, fit the exponent on the tail.
+    std::vector<Sample> tail;
+    for (auto it = samples.cbegin(), end = samples.cend(); it != end; ++it)
+        if (it->length >= 1024)
+            tail.push_back(*it);
+
+    std::printf("%5u %5s %10.0f %9.2f  %s\n", index, wide ? "wide" : "char",
+        samples.empty() ? 0. : samples.back().length, 
+        growthExponent(tail.size() >= 2 ? tail : samples), 
+        stoppedAt ? "stopped, time budget exceeded" : "");
+}
+
+void run(const Config& config)
+{
+    SubstitutionManager manager;
+    manager.setBackend(config.backend);
+    Bench::loadRules(manager, config.rulesPath);
+
+    FILE* out = std::fopen(config.outputPath.c_str(), "w");
+    if (!out)
+        throw std::runtime_error("cannot write " + config.outputPath);
+    std::fprintf(out, "rule,wide,length,depth,match_ns,apply_ns\n");
+
+    const auto& rules = manager.rules();
+    for (size_t i = 0; i < rules.size(); ++i)
+        std::printf("rule %u: %s\n", static_cast<unsigned>(i + 1), 
+            rules[i]->regexpPattern.c_str());
+    std::printf("\n%5s %5s %10s %9s\n", "rule", "names", "max length", "exponent");
+
+    for (size_t i = 0; i < rules.size(); ++i)
+    {
+        measureRule(out, config, static_cast<unsigned>(i + 1), rules[i], false);
+        measureRule(out, config, static_cast<unsigned>(i + 1), rules[i], true);
+    }
+
+    std::fclose(out);
+}
+
+/**
+ * @brief   Runs the measurements with a larger stack than the main thread's.
+ */
+class MeasurementThread : public QThread
+{
+    const Config& m_config;
+    std::string m_error;
+public:
+    explicit MeasurementThread(const Config& config)
+        : m_config(config)
+    {}
+
+    const std::string& error() const { return m_error; }
+protected:
+    void run() override
+    {
+        try
+        {
+            ::run(m_config);
+        }
+        catch (const std::exception& e)
+        {
+            m_error = e.what();
+        }
+    }
+};
+
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        Bench::Options options(argc, argv);
+        Config config;
+        config.rulesPath = options.value("rules", 
+            RETYPEDEF_SOURCE_DIR "/resources/default_rules.ini");
+        config.outputPath = options.value("output", "scaling.csv");
+        config.backend = options.backend();
+        config.depth = options.number("depth", 20);
+        config.maxLength = options.number("max-length", 65536);
+        config.repeat = std::max(options.number("repeat", 5), 1u);
+        config.budgetMs = options.number("budget-ms", 2000);
+        const auto stackMb = options.number("stack-mb", 512);
+
+        std::printf("backend: %s, depth: %u, max length: %u, stack: %u MiB, output: %s\n\n",
+            RegexBackend::name(config.backend), config.depth, config.maxLength, stackMb, 
+            config.outputPath.c_str());
+
+        MeasurementThread thread(config);
+        thread.setStackSize(stackMb * 1024U * 1024U);
+        thread.start();
+        thread.wait();
+        if (!thread.error().empty())
+            throw std::runtime_error(thread.error());
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
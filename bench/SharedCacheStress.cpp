@@ -0,0 +1,201 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file    Multi-process stress test of the shared result cache.
+ *
+ * Starts a number of worker processes (this executable with @c --worker) attached to the 
+ * same segment. Every worker looks up random names from a common set and inserts those it
+ * misses. Each name's result is a deterministic function of the name and mask, with lengths
+ * up to the slot capacity, so any hit returning something else is a torn or misplaced read.
+ * The segment is kept small to force constant eviction of slots other workers are reading.
+ *
+ * Usage: retypedef_shared_cache_stress [--processes N] [--names N] [--seconds N] [--size-kb N]
+ */
+
+#include "BenchCommon.hpp"
+
+#include "SharedCache.hpp"
+
+#include <QProcess>
+#include <QStringList>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const uint32_t kMasks[] = { 0x00000000, 0x0EA27FFF, 0x06400007 };
+
+struct Config
+{
+    uint64_t tag;
+    unsigned names;
+    unsigned seconds;
+    unsigned sizeKb;
+};
+
+std::string mangledName(unsigned index)
+{
+    return "?name" + std::to_string(index) + "@@YAXXZ";
+}
+
+/**
+ * @brief   The result stored for a name, 0 to about 400 bytes, or failure for every 16th.
+ */
+bool expectedResult(unsigned index, uint32_t mask, std::string& text, int32_t& ret)
+{
+    ret = index % 16 ? static_cast<int32_t>(index ^ mask) & 0x7FFFFFFF : -1;
+    if (ret < 0)
+        return false;
+
+    text = "void __cdecl name" + std::to_string(index) + "(void) /" + std::to_string(mask);
+    text.append((index * 37) % 400, static_cast<char>('a' + index % 26));
+    return true;
+}
+
+int runWorker(const Config& config, unsigned worker)
+{
+    SharedCache cache;
+    cache.attach(config.tag, config.sizeKb * 1024);
+
+    std::mt19937 random(worker * 7919 + 1);
+    std::uniform_int_distribution<unsigned> pickName(0, config.names - 1);
+    std::uniform_int_distribution<unsigned> pickMask(0, 2);
+
+    uint64_t lookups = 0, hits = 0, inserts = 0, mismatches = 0;
+    char answer[1024];
+    std::string expected;
+    const auto deadline = std::chrono::steady_clock::now() 
+        + std::chrono::seconds(config.seconds);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        for (unsigned i = 0; i < 1000; ++i)
+        {
+            const auto index = pickName(random);
+            const auto mask = kMasks[pickMask(random)];
+            const auto mangled = mangledName(index);
+            int32_t expectedRet;
+            const bool hasText = expectedResult(index, mask, expected, expectedRet);
+
+            ++lookups;
+            int32_t ret;
+            if (cache.lookup(mangled.c_str(), mask, config.tag, answer, sizeof(answer), ret))
+            {
+                ++hits;
+                if (ret != expectedRet || (hasText && expected != answer))
+                    ++mismatches;
+            }
+            else
+            {
+                cache.insert(mangled.c_str(), mask, config.tag, expectedRet, 
+                    hasText ? expected.c_str() : nullptr);
+                ++inserts;
+            }
+        }
+    }
+
+    std::printf("worker %u: %llu lookups, %llu hits, %llu inserts, %llu mismatches\n", worker,
+        static_cast<unsigned long long>(lookups), static_cast<unsigned long long>(hits),
+        static_cast<unsigned long long>(inserts), static_cast<unsigned long long>(mismatches));
+    return mismatches ? 2 : 0;
+}
+
+int runParent(const Config& config, unsigned processes, const char* program)
+{
+    // Keep the segment alive for the whole run.
+    SharedCache cache;
+    cache.attach(config.tag, config.sizeKb * 1024);
+    std::printf("processes: %u, names: %u, seconds: %u, segment: %u KiB (%s)\n\n", processes,
+        config.names, config.seconds, config.sizeKb, 
+        SharedCache::segmentKey(config.tag).toStdString().c_str());
+
+    char tag[32];
+    std::snprintf(tag, sizeof(tag), "%llu", static_cast<unsigned long long>(config.tag));
+    std::vector<std::unique_ptr<QProcess>> workers;
+    for (unsigned i = 0; i < processes; ++i)
+    {
+        QStringList args;
+        args << "--worker" << QString::number(i) << "--tag" << tag 
+            << "--names" << QString::number(config.names) 
+            << "--seconds" << QString::number(config.seconds)
+            << "--size-kb" << QString::number(config.sizeKb);
+        workers.emplace_back(new QProcess);
+        workers.back()->setProcessChannelMode(QProcess::ForwardedChannels);
+        workers.back()->start(program, args);
+        if (!workers.back()->waitForStarted())
+            throw std::runtime_error("cannot start worker process");
+    }
+
+    int failed = 0;
+    for (auto it = workers.begin(), end = workers.end(); it != end; ++it)
+    {
+        (*it)->waitForFinished(-1);
+        if ((*it)->exitStatus() != QProcess::NormalExit || (*it)->exitCode() != 0)
+            ++failed;
+    }
+
+    std::printf("\n%s: %d of %u workers failed\n", failed ? "FAILED" : "passed", failed, 
+        processes);
+    return failed ? 1 : 0;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        Bench::Options options(argc, argv);
+        Config config;
+        config.names = std::max(options.number("names", 20000), 1u);
+        config.seconds = options.number("seconds", 10);
+        config.sizeKb = std::max(options.number("size-kb", 256), 4u);
+
+        // A fresh tag per run, so runs never share a segment.
+        const auto tagText = options.value("tag", std::string());
+        config.tag = tagText.empty() 
+            ? static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())
+            : std::strtoull(tagText.c_str(), nullptr, 10);
+
+        const auto worker = options.value("worker", std::string());
+        if (!worker.empty())
+            return runWorker(config, static_cast<unsigned>(std::strtoul(worker.c_str(), 
+                nullptr, 10)));
+        return runParent(config, std::max(options.number("processes", 8), 1u), argv[0]);
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+}
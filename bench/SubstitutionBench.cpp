@@ -0,0 +1,147 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file    Headless throughput and latency benchmark of the substitution engine.
+ *
+ * Runs SubstitutionManager::applyToString over a corpus of MSVC demangled names, once with the
+ * default rules and once with an additional synthetic rule pack, and reports the cost per name.
+ *
+ * Usage: retypedef_bench [--corpus FILE] [--rules FILE] [--backend std|re2|pcre2]
+ *                        [--iterations N] [--synthetic N]
+ */
+
+#include "BenchCommon.hpp"
+
+#include "SubstitutionManager.hpp"
+#include "ScratchArena.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+
+/**
+ * @brief   Size of the output buffer, matching IDA's MAXSTR.
+ */
+const size_t kBufferSize = 1024;
+
+void runPack(const char* label, const SubstitutionManager& manager, 
+    const std::vector<std::string>& names, unsigned iterations)
+{
+    char buffer[kBufferSize];
+    auto load = [&buffer](const std::string& name)
+    {
+        auto length = std::min(name.size(), kBufferSize - 1);
+        ::memcpy(buffer, name.data(), length);
+        buffer[length] = '\0';
+    };
+
+    // Warm up caches and scratch buffers.
+    for (auto it = names.cbegin(), end = names.cend(); it != end; ++it)
+    {
+        load(*it);
+        manager.applyToString(buffer, kBufferSize);
+    }
+
+    std::vector<uint64_t> samples;
+    samples.reserve(names.size() * iterations);
+    uint64_t rewritten = 0;
+
+    const auto allocationsBefore = Bench::allocationCount();
+    const auto growthBefore = ScratchArena::growthCount();
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        for (auto it = names.cbegin(), end = names.cend(); it != end; ++it)
+        {
+            load(*it);
+            const auto start = Bench::nowNs();
+            if (manager.applyToString(buffer, kBufferSize))
+                ++rewritten;
+            samples.push_back(Bench::nowNs() - start);
+        }
+    }
+    const auto allocations = Bench::allocationCount() - allocationsBefore;
+    const auto growth = ScratchArena::growthCount() - growthBefore;
+
+    const auto calls = samples.size();
+    const auto stats = Bench::summarize(samples);
+    std::printf("%-28s %6u %10.1f %12.0f %11.2f %9llu %9llu %10llu %8.1f%% %6llu\n",
+        label, static_cast<unsigned>(manager.rules().size()), stats.meanNs, 
+        stats.namesPerSecond, static_cast<double>(allocations) / calls, 
+        static_cast<unsigned long long>(stats.p50Ns), 
+        static_cast<unsigned long long>(stats.p99Ns), 
+        static_cast<unsigned long long>(stats.maxNs), 100. * rewritten / calls,
+        static_cast<unsigned long long>(growth));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        Bench::Options options(argc, argv);
+        const auto corpusPath = options.value("corpus", 
+            RETYPEDEF_SOURCE_DIR "/bench/corpus/msvc_demangled.txt");
+        const auto rulesPath = options.value("rules", 
+            RETYPEDEF_SOURCE_DIR "/resources/default_rules.ini");
+        const auto iterations = options.number("iterations", 20);
+        const auto syntheticCount = options.number("synthetic", 1000);
+        const auto backend = options.backend();
+
+        const auto names = Bench::loadLines(corpusPath);
+        std::printf("corpus: %s (%u names), backend: %s, iterations: %u\n\n", 
+            corpusPath.c_str(), static_cast<unsigned>(names.size()), 
+            RegexBackend::name(backend), iterations);
+        std::printf("%-28s %6s %10s %12s %11s %9s %9s %10s %9s %6s\n", "rule pack", "rules", 
+            "ns/name", "names/s", "allocs/name", "p50 ns", "p99 ns", "max ns", "rewritten", 
+            "arena");
+
+        {
+            SubstitutionManager manager;
+            manager.setBackend(backend);
+            Bench::loadRules(manager, rulesPath);
+            runPack("default_rules.ini", manager, names, iterations);
+        }
+
+        {
+            SubstitutionManager manager;
+            manager.setBackend(backend);
+            Bench::loadRules(manager, rulesPath);
+            Bench::addSyntheticRules(manager, syntheticCount);
+            runPack("default + synthetic", manager, names, iterations);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
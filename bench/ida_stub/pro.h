@@ -0,0 +1,64 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 athre0z
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BENCH_IDA_STUB_PRO_H
+#define BENCH_IDA_STUB_PRO_H
+
+/**
+ * @file    Minimal stand-in for the parts of the IDA SDK used by the substitution engine,
+ *          allowing it to be built and benchmarked without IDA.
+ */
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+
+typedef unsigned int uint;
+typedef int int32;
+typedef unsigned int uint32;
+
+#define idaapi
+
+inline int msg(const char* format, ...)
+{
+    va_list va;
+    va_start(va, format);
+    int ret = vfprintf(stderr, format, va);
+    va_end(va);
+    return ret;
+}
+
+inline char* qstrncpy(char* dst, const char* src, size_t dstsize)
+{
+    if (!dstsize)
+        return dst;
+    size_t length = strlen(src);
+    if (length >= dstsize)
+        length = dstsize - 1;
+    memmove(dst, src, length);
+    dst[length] = '\0';
+    return dst;
+}
+
+#endif // BENCH_IDA_STUB_PRO_H
@@ -0,0 +1,22 @@
+# Plots the output of retypedef_scaling_bench on log-log axes, one line per rule and string
+# flavor. A slope of 1 is linear, 2 is quadratic.
+#
+# Usage: gnuplot -e "data='scaling.csv'; rules=4" plot_scaling.gp
+
+if (!exists("data")) data = 'scaling.csv'
+if (!exists("rules")) rules = 4
+if (!exists("column_name")) column_name = 'apply_ns'
+
+set datafile separator ","
+set terminal pngcairo size 1200,800
+set output 'scaling.png'
+set title sprintf("%s by name length", column_name)
+set xlabel "name length [bytes]"
+set ylabel "time [ns]"
+set logscale xy
+set key top left
+set grid
+
+plot for [rule=1:rules] for [wide=0:1] data \
+        using 3:(($1 == rule && $2 == wide) ? column(column_name) : 1/0) \
+        with linespoints title sprintf("rule %d (%s)", rule, wide ? "wchar_t" : "char")